@@ -0,0 +1,645 @@
+//
+// Benchmark of CEEngine on the demo workload. It is not part of the submission; build it with the bench target.
+//
+
+#include <CardinalityEstimation.h>
+#include <executer/DataExecuterDemo.h>
+#include <executer/BinaryTrace.h>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+
+/**
+ * A struct for the benchmark options, set from --name value pairs on the command line.
+ */
+typedef struct BenchOptions {
+    long long rows = 1000000;
+    int ops = 100000;
+    DemoConfig demo;
+    // Text and binary traces to write the generated workload to, or to replay instead of generating one.
+    std::string record;
+    std::string replay;
+    std::string recordBinary;
+    std::string replayBinary;
+    // Statistics snapshot to write after the constructor, and to warm-start the constructor from.
+    std::string saveSnapshot;
+    std::string loadSnapshot;
+    // Instrumentation stats written when the engine is destroyed, for builds with CE_INSTRUMENT.
+    std::string stats;
+    // Consecutive queries of a binary trace answered by one queryBatch call, if above 1.
+    int batch = 0;
+    // EngineConfig::memoryBudget in MB, 0 for no limit.
+    double memoryMb = 0;
+    // Scenario of the regression suite to run, or "all"; see suiteScenarios.
+    std::string suite;
+    // Suite latencies to compare against instead of the limits of the scenarios, and file to record them to.
+    std::string baseline;
+    std::string saveBaseline;
+    // Bound the constructor and prepare() by their tuple and step budgets only, so that the statistics, and with them
+    // every estimate, depend on the seed alone and not on the speed of the machine.
+    bool deterministic = false;
+} BenchOptions;
+
+/**
+ * Samples of one measured quantity, summarized by percentiles.
+ */
+class Samples {
+private:
+    std::vector<double> values;
+
+public:
+    void add(double value) { values.push_back(value); }
+    size_t size() const { return values.size(); }
+    double mean() const
+    {
+        double sum = 0;
+        for (int i = 0; i < (int)values.size(); ++i)
+            sum += values[i];
+        return values.empty() ? 0 : sum / values.size();
+    }
+    // Nearest-rank percentile, p in [0, 100].
+    double percentile(double p)
+    {
+        if (values.empty())
+            return 0;
+        size_t rank = (size_t)std::ceil(p / 100 * values.size());
+        size_t k = std::min(values.size() - 1, rank == 0 ? 0 : rank - 1);
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+};
+
+static void usage(const char *program)
+{
+    std::cerr << "usage: " << program << " [--rows N] [--ops N] [--columns N] [--insert PCT] [--delete PCT]"
+              << " [--predicates MIN[:MAX]] [--ops-kind equal|greater|both] [--domain N] [--seed N]"
+              << " [--dist D[,D...]] [--skew S] [--spread F] [--correlate COLUMN:SOURCE:P]"
+              << " [--record FILE] [--replay FILE] [--record-binary FILE] [--replay-binary FILE]"
+              << " [--save-snapshot FILE] [--load-snapshot FILE] [--stats FILE] [--batch N]"
+              << " [--memory MB] [--suite all|NAME] [--baseline FILE] [--save-baseline FILE]" << std::endl;
+    std::cerr << "distributions: uniform zipf normal clustered sorted, one per column, the last one repeated"
+              << std::endl;
+    std::cerr << "suite scenarios: uniform skewed correlated delete-heavy query-heavy" << std::endl;
+}
+
+static ColumnSpec &specOf(DemoConfig &demo, int column)
+{
+    if ((int)demo.specs.size() <= column)
+        demo.specs.resize(column + 1, demo.specs.empty() ? ColumnSpec() : demo.specs.back());
+    return demo.specs[column];
+}
+
+static bool parseDistributions(const char *value, DemoConfig &demo)
+{
+    std::string list = value;
+    int column = 0;
+    for (size_t begin = 0; begin <= list.size(); ++column) {
+        size_t comma = std::min(list.find(',', begin), list.size());
+        if (!parseDistribution(list.substr(begin, comma - begin).c_str(), specOf(demo, column).distribution))
+            return false;
+        begin = comma + 1;
+    }
+    return true;
+}
+
+static bool parseOptions(int argc, char *argv[], BenchOptions &options)
+{
+    double skew = -1;
+    double spread = -1;
+    // Correlated column, and its source column and correlation.
+    std::vector<std::pair<int, ColumnSpec>> correlations;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc)
+            return false;
+        const char *name = argv[i];
+        const char *value = argv[i + 1];
+        if (strcmp(name, "--rows") == 0) {
+            options.rows = atoll(value);
+        } else if (strcmp(name, "--ops") == 0) {
+            options.ops = atoi(value);
+        } else if (strcmp(name, "--columns") == 0) {
+            options.demo.columns = atoi(value);
+        } else if (strcmp(name, "--insert") == 0) {
+            options.demo.insertPercent = atoi(value);
+        } else if (strcmp(name, "--delete") == 0) {
+            options.demo.deletePercent = atoi(value);
+        } else if (strcmp(name, "--predicates") == 0) {
+            const char *colon = strchr(value, ':');
+            options.demo.minPredicates = atoi(value);
+            options.demo.maxPredicates = colon != nullptr ? atoi(colon + 1) : options.demo.minPredicates;
+        } else if (strcmp(name, "--ops-kind") == 0) {
+            options.demo.equalPredicates = strcmp(value, "greater") != 0;
+            options.demo.greaterPredicates = strcmp(value, "equal") != 0;
+        } else if (strcmp(name, "--domain") == 0) {
+            options.demo.domain = atoi(value);
+        } else if (strcmp(name, "--seed") == 0) {
+            options.demo.seed = (unsigned)atoll(value);
+        } else if (strcmp(name, "--dist") == 0) {
+            if (!parseDistributions(value, options.demo))
+                return false;
+        } else if (strcmp(name, "--skew") == 0) {
+            skew = atof(value);
+        } else if (strcmp(name, "--spread") == 0) {
+            spread = atof(value);
+        } else if (strcmp(name, "--correlate") == 0) {
+            ColumnSpec link;
+            int column;
+            if (sscanf(value, "%d:%d:%lf", &column, &link.source, &link.correlation) != 3 || column <= link.source ||
+                link.source < 0)
+                return false;
+            correlations.push_back(std::make_pair(column, link));
+        } else if (strcmp(name, "--record") == 0) {
+            options.record = value;
+        } else if (strcmp(name, "--replay") == 0) {
+            options.replay = value;
+        } else if (strcmp(name, "--record-binary") == 0) {
+            options.recordBinary = value;
+        } else if (strcmp(name, "--replay-binary") == 0) {
+            options.replayBinary = value;
+        } else if (strcmp(name, "--save-snapshot") == 0) {
+            options.saveSnapshot = value;
+        } else if (strcmp(name, "--load-snapshot") == 0) {
+            options.loadSnapshot = value;
+        } else if (strcmp(name, "--stats") == 0) {
+            options.stats = value;
+        } else if (strcmp(name, "--batch") == 0) {
+            options.batch = atoi(value);
+        } else if (strcmp(name, "--memory") == 0) {
+            options.memoryMb = atof(value);
+        } else if (strcmp(name, "--suite") == 0) {
+            options.suite = value;
+        } else if (strcmp(name, "--baseline") == 0) {
+            options.baseline = value;
+        } else if (strcmp(name, "--save-baseline") == 0) {
+            options.saveBaseline = value;
+        } else {
+            return false;
+        }
+    }
+    DemoConfig &demo = options.demo;
+    if (!demo.specs.empty())
+        specOf(demo, demo.columns - 1);
+    for (int c = 0; c < (int)demo.specs.size(); ++c) {
+        if (skew > 0)
+            demo.specs[c].skew = skew;
+        if (spread > 0)
+            demo.specs[c].spread = spread;
+    }
+    for (int k = 0; k < (int)correlations.size(); ++k) {
+        ColumnSpec &spec = specOf(demo, correlations[k].first);
+        spec.source = correlations[k].second.source;
+        spec.correlation = correlations[k].second.correlation;
+    }
+    return options.rows > 0 && options.rows <= INT32_MAX && options.ops >= 0 && demo.columns > 0 &&
+           demo.insertPercent >= 0 && demo.deletePercent >= 0 && demo.insertPercent + demo.deletePercent <= 100 &&
+           demo.minPredicates > 0 && demo.maxPredicates >= demo.minPredicates && demo.domain >= 0 &&
+           (options.batch <= 1 || !options.replayBinary.empty()) && options.memoryMb >= 0;
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static void printRow(const char *name, Samples &samples)
+{
+    printf("%-12s %10zu %12.3f %12.3f %12.3f %12.3f\n", name, samples.size(), samples.mean(), samples.percentile(50),
+           samples.percentile(99), samples.percentile(100));
+}
+
+/**
+ * A struct for the measurements of one run.
+ */
+typedef struct BenchResult {
+    Samples constructor, prepare, insert, remove, query, error;
+    long long tuplesRead = 0;
+    long long constructorReads = 0;
+    bool warmStarted = false;
+    long long driftChecks = 0;
+    long long driftRepairs = 0;
+    MemoryUsage memory = MemoryUsage();
+} BenchResult;
+
+static EngineConfig engineConfig(const BenchOptions &options)
+{
+    EngineConfig config;
+    config.snapshotPath = options.loadSnapshot;
+    config.statsPath = options.stats;
+    config.memoryBudget = (size_t)(options.memoryMb * (1 << 20));
+    if (options.deterministic) {
+        config.bootstrapTimeBudgetMs = INT32_MAX;
+        config.prepareBudgetUs = 1e18;
+    }
+    return config;
+}
+
+// Record how the engine was started and save its statistics if asked; false if the snapshot cannot be written.
+static bool afterConstructor(const BenchOptions &options, const CEEngine &ceEngine, BenchResult &result)
+{
+    result.warmStarted = ceEngine.isWarmStarted();
+    if (!options.loadSnapshot.empty() && !result.warmStarted)
+        std::cerr << "snapshot " << options.loadSnapshot << " is stale or unreadable, statistics rebuilt" << std::endl;
+    if (!options.saveSnapshot.empty() && !ceEngine.saveSnapshot(options.saveSnapshot)) {
+        std::cerr << "cannot write snapshot " << options.saveSnapshot << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static int runDemo(BenchOptions &options, BenchResult &result)
+{
+    std::unique_ptr<DataExecuterDemo> demo;
+    if (!options.replay.empty()) {
+        demo.reset(new DataExecuterDemo(options.replay));
+        if (!demo->isValid()) {
+            std::cerr << "cannot read trace " << options.replay << std::endl;
+            return 1;
+        }
+        options.rows = demo->getTupleCount();
+    } else {
+        demo.reset(new DataExecuterDemo((int)options.rows - 1, options.ops, options.demo));
+    }
+    DataExecuterDemo &dataExecuter = *demo;
+    if (!options.record.empty() && !dataExecuter.startRecording(options.record)) {
+        std::cerr << "cannot write trace " << options.record << std::endl;
+        return 1;
+    }
+    TraceWriter writer;
+    if (!options.recordBinary.empty() && !writer.open(options.recordBinary, dataExecuter.getColumns(),
+                                                      dataExecuter.getTupleCount(), dataExecuter.getRows())) {
+        std::cerr << "cannot write trace " << options.recordBinary << std::endl;
+        return 1;
+    }
+    bool recordBinary = !options.recordBinary.empty();
+    int initSize = (int)options.rows;
+
+    auto begin = std::chrono::steady_clock::now();
+    CEEngine ceEngine(initSize, &dataExecuter, engineConfig(options));
+    result.constructor.add(elapsedUs(begin));
+    result.constructorReads = dataExecuter.getTuplesRead();
+    if (!afterConstructor(options, ceEngine, result))
+        return 1;
+
+    // One Action is refilled by every step, so its buffers are reused.
+    Action action;
+    dataExecuter.getNextAction(action);
+    while (action.actionType != NONE) {
+        begin = std::chrono::steady_clock::now();
+        ceEngine.prepare();
+        result.prepare.add(elapsedUs(begin));
+        begin = std::chrono::steady_clock::now();
+        if (action.actionType == INSERT) {
+            ceEngine.insertTuple(action.actionTuple);
+            result.insert.add(elapsedUs(begin));
+            if (recordBinary)
+                writer.insert(action.actionTuple.data());
+        } else if (action.actionType == DELETE) {
+            ceEngine.deleteTuple(action.actionTuple, action.tupleId);
+            result.remove.add(elapsedUs(begin));
+            if (recordBinary)
+                writer.remove(action.tupleId, action.actionTuple.data());
+        } else if (action.actionType == QUERY) {
+            int ans = ceEngine.query(action.quals);
+            result.query.add(elapsedUs(begin));
+            result.error.add(dataExecuter.answer(ans));
+            if (recordBinary)
+                writer.query(action.quals, dataExecuter.getExactAnswer());
+        }
+        dataExecuter.getNextAction(action);
+    }
+    if (!dataExecuter.isValid()) {
+        std::cerr << "trace " << options.replay << " is truncated or malformed" << std::endl;
+        return 1;
+    }
+    if (recordBinary && !writer.close()) {
+        std::cerr << "cannot write trace " << options.recordBinary << std::endl;
+        return 1;
+    }
+    result.tuplesRead = dataExecuter.getTuplesRead();
+    result.driftChecks = ceEngine.getDriftMonitor().getChecks();
+    result.driftRepairs = ceEngine.getDriftMonitor().getRepairs();
+    result.memory = ceEngine.getMemoryUsage();
+    return 0;
+}
+
+static int runMapped(BenchOptions &options, BenchResult &result)
+{
+    MappedTraceExecuter dataExecuter;
+    if (!dataExecuter.open(options.replayBinary)) {
+        std::cerr << "cannot map trace " << options.replayBinary << std::endl;
+        return 1;
+    }
+    options.rows = dataExecuter.getInitialTuples();
+    auto begin = std::chrono::steady_clock::now();
+    CEEngine ceEngine((int)options.rows, &dataExecuter, engineConfig(options));
+    result.constructor.add(elapsedUs(begin));
+    result.constructorReads = dataExecuter.getTuplesRead();
+    if (!afterConstructor(options, ceEngine, result))
+        return 1;
+
+    // Tuples are passed straight from the mapping. Queries take vectors, so predicates are copied into a buffer
+    // reused by every action.
+    int columns = dataExecuter.getColumns();
+    std::vector<CompareExpression> quals;
+    TraceAction action;
+    long long replayed = 0;
+    // With --batch, queries are collected and answered together once the batch is full or another action comes.
+    std::vector<std::vector<CompareExpression>> batch;
+    std::vector<TraceAction> batchActions;
+    std::vector<int> answers;
+    auto flush = [&]() {
+        if (batch.empty())
+            return;
+        auto start = std::chrono::steady_clock::now();
+        ceEngine.queryBatch(batch, answers);
+        double perQuery = elapsedUs(start) / batch.size();
+        for (int k = 0; k < (int)batch.size(); ++k) {
+            result.query.add(perQuery);
+            result.error.add(MappedTraceExecuter::answer(answers[k], batchActions[k]));
+        }
+        batch.clear();
+        batchActions.clear();
+    };
+    while (dataExecuter.next(action)) {
+        replayed++;
+        begin = std::chrono::steady_clock::now();
+        ceEngine.prepare();
+        result.prepare.add(elapsedUs(begin));
+        if (action.type == QUERY && options.batch > 1) {
+            batch.push_back(std::vector<CompareExpression>(action.quals, action.quals + action.predicates));
+            batchActions.push_back(action);
+            if ((int)batch.size() >= options.batch)
+                flush();
+            continue;
+        }
+        flush();
+        if (action.type == QUERY)
+            quals.assign(action.quals, action.quals + action.predicates);
+        begin = std::chrono::steady_clock::now();
+        if (action.type == INSERT) {
+            ceEngine.insertTuple(action.tuple, columns);
+            result.insert.add(elapsedUs(begin));
+        } else if (action.type == DELETE) {
+            ceEngine.deleteTuple(action.tuple, columns, action.tupleId);
+            result.remove.add(elapsedUs(begin));
+        } else {
+            int ans = ceEngine.query(quals);
+            result.query.add(elapsedUs(begin));
+            result.error.add(MappedTraceExecuter::answer(ans, action));
+        }
+    }
+    flush();
+    if (replayed != dataExecuter.getActions()) {
+        std::cerr << "trace " << options.replayBinary << " is truncated or malformed" << std::endl;
+        return 1;
+    }
+    result.tuplesRead = dataExecuter.getTuplesRead();
+    result.driftChecks = ceEngine.getDriftMonitor().getChecks();
+    result.driftRepairs = ceEngine.getDriftMonitor().getRepairs();
+    result.memory = ceEngine.getMemoryUsage();
+    return 0;
+}
+
+/**
+ * A struct for one scenario of the regression suite: the workload, generated from a fixed seed, and the limits its
+ * run must stay within. Latencies are means in microseconds, reads are readTuples calls per initial row.
+ */
+typedef struct Scenario {
+    const char *name;
+    BenchOptions options;
+    double meanError;
+    double p95Error;
+    double insertUs;
+    double deleteUs;
+    double queryUs;
+    double prepareUs;
+    double readsPerRow;
+} Scenario;
+
+static BenchOptions suiteOptions(int columns, int insertPercent, int deletePercent, int minPredicates,
+                                 int maxPredicates)
+{
+    BenchOptions options;
+    options.rows = 100000;
+    options.ops = 20000;
+    // A budget well below the table keeps the sample partial, so that the errors measure the estimators.
+    options.memoryMb = 1;
+    options.deterministic = true;
+    options.demo.seed = 29;
+    options.demo.columns = columns;
+    options.demo.insertPercent = insertPercent;
+    options.demo.deletePercent = deletePercent;
+    options.demo.minPredicates = minPredicates;
+    options.demo.maxPredicates = maxPredicates;
+    return options;
+}
+
+static ColumnSpec columnSpec(Distribution distribution, int source = -1, double correlation = 0)
+{
+    ColumnSpec spec;
+    spec.distribution = distribution;
+    spec.source = source;
+    spec.correlation = correlation;
+    return spec;
+}
+
+// The errors are exact for the fixed seeds and are kept close to what the current estimators reach. The latency limits
+// are about twice the slowest of several runs of an optimized build on an x86-64 Xeon server, where the means vary by up
+// to 1.5x from run to run. On another machine, compare against a baseline recorded there with --save-baseline.
+static std::vector<Scenario> suiteScenarios()
+{
+    std::vector<Scenario> scenarios;
+    Scenario uniform = {"uniform", suiteOptions(4, 10, 5, 1, 2), 0.008, 0.03, 0.25, 0.8, 6, 1.5, 1.05};
+    scenarios.push_back(uniform);
+
+    Scenario skewed = {"skewed", suiteOptions(4, 10, 5, 1, 2), 0.6, 3.5, 0.25, 0.8, 5, 2, 1.05};
+    skewed.options.demo.domain = 100000;
+    skewed.options.demo.specs.assign(4, columnSpec(DIST_ZIPF));
+    scenarios.push_back(skewed);
+
+    Scenario correlated = {"correlated", suiteOptions(4, 10, 5, 2, 2), 0.011, 0.032, 0.25, 0.8, 8, 1.5, 1.05};
+    correlated.options.demo.specs.assign(4, columnSpec(DIST_NORMAL));
+    correlated.options.demo.specs[1] = columnSpec(DIST_NORMAL, 0, 0.9);
+    correlated.options.demo.specs[3] = columnSpec(DIST_NORMAL, 2, 0.8);
+    scenarios.push_back(correlated);
+
+    Scenario deleteHeavy = {"delete-heavy", suiteOptions(3, 10, 40, 1, 2), 0.018, 0.05, 0.25, 0.5, 5, 1.5, 1.05};
+    deleteHeavy.options.demo.specs.assign(3, columnSpec(DIST_CLUSTERED));
+    scenarios.push_back(deleteHeavy);
+
+    Scenario queryHeavy = {"query-heavy", suiteOptions(6, 1, 1, 1, 3), 0.23, 1.4, 1, 2.5, 9, 1.5, 1.05};
+    queryHeavy.options.demo.domain = 1000000;
+    queryHeavy.options.demo.specs = {columnSpec(DIST_ZIPF), columnSpec(DIST_NORMAL), columnSpec(DIST_UNIFORM),
+                                     columnSpec(DIST_SORTED), columnSpec(DIST_CLUSTERED), columnSpec(DIST_ZIPF)};
+    scenarios.push_back(queryHeavy);
+    return scenarios;
+}
+
+// Append "name value > limit" to failures when a measurement exceeds its limit.
+static void checkLimit(const char *name, double value, double limit, std::string &failures)
+{
+    if (value <= limit)
+        return;
+    char text[96];
+    snprintf(text, sizeof(text), " %s %.4g > %.4g", name, value, limit);
+    failures += text;
+}
+
+// A baseline run may take this many times its recorded latencies.
+static const double BASELINE_FACTOR = 2;
+
+/**
+ * Read the latencies of a baseline file, one "scenario insert delete query prepare" line per scenario, into the limits
+ * of the scenarios it names, with BASELINE_FACTOR room.
+ * @return return false if the file cannot be read or a line is malformed.
+ */
+static bool loadBaseline(const std::string &path, std::vector<Scenario> &scenarios)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr)
+        return false;
+    char line[256];
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file) != nullptr) {
+        char name[64];
+        double us[4];
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        valid = sscanf(line, "%63s %lf %lf %lf %lf", name, &us[0], &us[1], &us[2], &us[3]) == 5;
+        for (int k = 0; k < (int)scenarios.size() && valid; ++k) {
+            Scenario &scenario = scenarios[k];
+            if (strcmp(scenario.name, name) != 0)
+                continue;
+            scenario.insertUs = us[0] * BASELINE_FACTOR;
+            scenario.deleteUs = us[1] * BASELINE_FACTOR;
+            scenario.queryUs = us[2] * BASELINE_FACTOR;
+            scenario.prepareUs = us[3] * BASELINE_FACTOR;
+        }
+    }
+    fclose(file);
+    return valid;
+}
+
+/**
+ * Run the scenarios of the regression suite named by options.suite, or all of them, and print one row per scenario.
+ * @param options the options holding the suite name and baseline files
+ * @return return 0 when every scenario stays within its limits, 1 when one does not or a baseline file cannot be
+ * used, 2 for an unknown name
+ */
+static int runSuite(const BenchOptions &options)
+{
+    std::vector<Scenario> scenarios = suiteScenarios();
+    if (!options.baseline.empty() && !loadBaseline(options.baseline, scenarios)) {
+        std::cerr << "cannot read baseline " << options.baseline << std::endl;
+        return 1;
+    }
+    // The limits of the scenarios are meant for an optimized build, which ce_suite always is.
+    bool checkLatency = !options.baseline.empty();
+#ifdef __OPTIMIZE__
+    checkLatency = true;
+#endif
+    if (!checkLatency)
+        printf("unoptimized build without --baseline: latencies are not checked\n");
+    FILE *saved = options.saveBaseline.empty() ? nullptr : fopen(options.saveBaseline.c_str(), "w");
+    if (!options.saveBaseline.empty() && saved == nullptr) {
+        std::cerr << "cannot write baseline " << options.saveBaseline << std::endl;
+        return 1;
+    }
+    if (saved != nullptr)
+        fprintf(saved, "# scenario insert delete query prepare, mean us\n");
+    int failed = 0;
+    int run = 0;
+    printf("%-13s %10s %10s %10s %10s %10s %10s %10s  %s\n", "scenario", "q-err", "q-err p95", "insert", "delete",
+           "query", "prepare", "reads/row", "result");
+    for (int k = 0; k < (int)scenarios.size(); ++k) {
+        Scenario &scenario = scenarios[k];
+        if (options.suite != "all" && options.suite != scenario.name)
+            continue;
+        run++;
+        BenchResult result;
+        if (runDemo(scenario.options, result) != 0) {
+            if (saved != nullptr)
+                fclose(saved);
+            return 1;
+        }
+        double readsPerRow = (double)result.tuplesRead / scenario.options.rows;
+        std::string failures;
+        checkLimit("q-err", result.error.mean(), scenario.meanError, failures);
+        checkLimit("q-err-p95", result.error.percentile(95), scenario.p95Error, failures);
+        if (checkLatency) {
+            checkLimit("insert", result.insert.mean(), scenario.insertUs, failures);
+            checkLimit("delete", result.remove.mean(), scenario.deleteUs, failures);
+            checkLimit("query", result.query.mean(), scenario.queryUs, failures);
+            checkLimit("prepare", result.prepare.mean(), scenario.prepareUs, failures);
+        }
+        checkLimit("reads/row", readsPerRow, scenario.readsPerRow, failures);
+        failed += !failures.empty();
+        printf("%-13s %10.6f %10.6f %10.3f %10.3f %10.3f %10.3f %10.4f  %s%s\n", scenario.name, result.error.mean(),
+               result.error.percentile(95), result.insert.mean(), result.remove.mean(), result.query.mean(),
+               result.prepare.mean(), readsPerRow, failures.empty() ? "ok" : "FAILED", failures.c_str());
+        if (saved != nullptr)
+            fprintf(saved, "%s %.4f %.4f %.4f %.4f\n", scenario.name, result.insert.mean(), result.remove.mean(),
+                    result.query.mean(), result.prepare.mean());
+    }
+    if (saved != nullptr)
+        fclose(saved);
+    if (run == 0)
+        return 2;
+    printf("%d of %d scenarios within their limits\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+#ifdef CE_SUITE
+    // ce_suite runs the whole regression suite unless told otherwise.
+    options.suite = "all";
+#endif
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!options.suite.empty()) {
+        int status = runSuite(options);
+        if (status == 2)
+            usage(argv[0]);
+        return status;
+    }
+    if (!options.stats.empty() && !CEEngine::isInstrumented())
+        std::cerr << "--stats needs a build configured with -DCE_INSTRUMENT=ON, no stats written" << std::endl;
+    BenchResult result;
+    int status = options.replayBinary.empty() ? runDemo(options, result) : runMapped(options, result);
+    if (status != 0)
+        return status;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    if (!options.replayBinary.empty())
+        printf("rows %lld trace %s\n", options.rows, options.replayBinary.c_str());
+    else if (!options.replay.empty())
+        printf("rows %lld trace %s\n", options.rows, options.replay.c_str());
+    else
+        printf("rows %lld ops %d columns %d seed %u\n", options.rows, options.ops, options.demo.columns,
+               options.demo.seed);
+    printf("%-12s %10s %12s %12s %12s %12s\n", "latency(us)", "count", "mean", "p50", "p99", "max");
+    printRow("constructor", result.constructor);
+    printRow("prepare", result.prepare);
+    printRow("insertTuple", result.insert);
+    printRow("deleteTuple", result.remove);
+    // Batched queries are timed per estimate, the batch time split evenly.
+    printRow(options.batch > 1 ? "queryBatch" : "query", result.query);
+    printf("readTuples   %lld tuples (%lld in the constructor, %s start)\n", result.tuplesRead, result.constructorReads,
+           result.warmStarted ? "warm" : "cold");
+    printf("drift        %lld checks, %lld buckets split\n", result.driftChecks, result.driftRepairs);
+    printf("peak RSS     %.1f MB\n", usage.ru_maxrss / 1024.0);
+    const MemoryUsage &memory = result.memory;
+    const double mb = 1 << 20;
+    printf("memory       %.1f MB (budget %.1f, planned %.1f), arena %.1f of %.1f MB used, %.1f free, %.1f overflow, "
+           "buffers %.1f MB\n",
+           memory.total / mb, memory.budget / mb, memory.planned / mb, memory.arenaUsed / mb, memory.arenaReserved / mb,
+           memory.arenaFree / mb, memory.arenaOverflow / mb, memory.buffers / mb);
+    printf("q-error      mean %.6f p50 %.6f p99 %.6f max %.6f\n", result.error.mean(), result.error.percentile(50),
+           result.error.percentile(99), result.error.percentile(100));
+    return 0;
+}
@@ -1,44 +1,352 @@
-#ifndef CARDINALITYESTIMATION_ENGINE
-#define CARDINALITYESTIMATION_ENGINE
-//
-// You should modify this file.
-//
-#include <executer/DataExecuter.h>
-#include <common/Expression.h>
-class CEEngine {
-public:
-    /**
-     * Insert a tuple, indicating that the tuple is inserted and appended to the end of the disk.
-     * @param tuple Inserted tuple.
-     */
-    void insertTuple(const std::vector<int>& tuple);
-    /**
-     * Deletion function. Pass a tuple and tupleId, indicating that the tuple at the tupleId position is deleted.
-     * @param tuple Deleted tuple.
-     * @param tupleId Location of the deleted tuple.
-     */
-    void deleteTuple(const std::vector<int>& tuple, int tupleId);
-    /**
-     * Query function, pass in expression, return estimated cardinality result.
-     * @param quals expression.
-     * @return return estimated cardinality result.
-     */
-    int query(const std::vector<CompareExpression>& quals);
-    /**
-     * Preprocessing function of the cardinality estimation algorithm. This function is executed before each operation
-     * is called.
-     */
-    void prepare();
-    /**
-     * The constructor function of cardinality estimation.
-     * @param num Size of the initial data set.
-     * @param dataExecuter Interfaces for datasets.
-     */
-    CEEngine(int num, DataExecuter *dataExecuter);
-    ~CEEngine() = default;
-
-private:
-    DataExecuter *dataExecuter;
-};
-
+#ifndef CARDINALITYESTIMATION_ENGINE
+#define CARDINALITYESTIMATION_ENGINE
+//
+// You should modify this file.
+//
+#include <executer/DataExecuter.h>
+#include <common/Expression.h>
+#include <estimator/EngineConfig.h>
+#include <estimator/ColumnSummary.h>
+#include <estimator/Reservoir.h>
+#include <estimator/SampleBootstrap.h>
+#include <estimator/TupleBatchReader.h>
+#include <estimator/PredicateKernels.h>
+#include <estimator/EquiDepthHistogram.h>
+#include <estimator/CdfModel.h>
+#include <estimator/FrequencySketch.h>
+#include <estimator/EstimatorPipeline.h>
+#include <estimator/ColumnRange.h>
+#include <estimator/GridHistogram.h>
+#include <estimator/MaintenanceScheduler.h>
+#include <estimator/EstimateCache.h>
+#include <estimator/DriftMonitor.h>
+#include <estimator/Snapshot.h>
+#include <estimator/Instrumentation.h>
+// Per-column estimators the engine is composed of, in the order a range is offered to them: the first one that
+// answers it gives the estimate. Configure with -DCE_COLUMN_ESTIMATORS="..." to benchmark another composition; the
+// estimators left out are neither built nor updated. An estimator is added by implementing the ColumnEstimator hooks
+// and naming it here.
+#ifndef CE_COLUMN_ESTIMATORS
+#define CE_COLUMN_ESTIMATORS CdfModel, FrequencySketch, EquiDepthHistogram
+#endif
+typedef EstimatorPipeline<CE_COLUMN_ESTIMATORS> ColumnPipeline;
+
+/**
+ * An enum stands for the synopsis a query is answered from.
+ */
+enum QueryPlan { PLAN_SAMPLE = 0, PLAN_COLUMN = 1, PLAN_GRID = 2 };
+
+/**
+ * An enum stands for the shape of a query, i.e. its number of predicates and their operators. Every shape but
+ * SHAPE_GENERIC has its own compiled query path; the predicates of a two-column shape are on distinct columns.
+ */
+enum QueryShape {
+    SHAPE_GENERIC = 0,
+    SHAPE_EQUAL = 1,
+    SHAPE_GREATER = 2,
+    SHAPE_EQUAL_GREATER = 3,
+    SHAPE_GREATER_GREATER = 4,
+    SHAPE_COUNT = 5
+};
+
+/**
+ * A struct for one bound of a column range in a query batch: the query gets sign times the number of rows greater
+ * than value on column.
+ */
+typedef struct BatchBound {
+    int column;
+    int value;
+    int query;
+    double sign;
+} BatchBound;
+
+/**
+ * A struct for the memory used by an engine, in bytes. The arena holds every statistic; the buffers are the reader
+ * batch and the query scratch, which live on the heap.
+ */
+typedef struct MemoryUsage {
+    // EngineConfig::memoryBudget, 0 if unlimited, and the footprint the configuration in use was sized for.
+    size_t budget;
+    size_t planned;
+    // Block reserved by the arena, the part of it handed out, the released ranges waiting for reuse, and the extra
+    // blocks taken once it was exhausted.
+    size_t arenaReserved;
+    size_t arenaUsed;
+    size_t arenaFree;
+    size_t arenaOverflow;
+    size_t buffers;
+    // arenaReserved + arenaOverflow + buffers.
+    size_t total;
+} MemoryUsage;
+
+class CEEngine {
+public:
+    /**
+     * Insert a tuple, indicating that the tuple is inserted and appended to the end of the disk.
+     * @param tuple Inserted tuple.
+     */
+    void insertTuple(const std::vector<int>& tuple);
+    /**
+     * Deletion function. Pass a tuple and tupleId, indicating that the tuple at the tupleId position is deleted.
+     * @param tuple Deleted tuple.
+     * @param tupleId Location of the deleted tuple.
+     */
+    void deleteTuple(const std::vector<int>& tuple, int tupleId);
+    /**
+     * Same as insertTuple on a tuple stored anywhere, e.g. in a buffer reused by every call. The first tuple the engine
+     * sees sets the number of columns; a tuple of another width is ignored.
+     * @param tuple Values of the tuple.
+     * @param columns Number of values of the tuple.
+     */
+    void insertTuple(const int *tuple, int columns);
+    /**
+     * Same as deleteTuple on a tuple stored anywhere. A tuple whose width is not the number of columns of the engine is
+     * ignored.
+     * @param tuple Values of the tuple.
+     * @param columns Number of values of the tuple.
+     * @param tupleId Location of the deleted tuple.
+     */
+    void deleteTuple(const int *tuple, int columns, int tupleId);
+    /**
+     * Insert tuples appended to the end of the disk, in order. Inserted and deleted tuples are staged and applied to
+     * the statistics together, once the staging area is full, by prepare(), or before the next query. Tuples of
+     * another width than the engine's are ignored, as insertTuple does.
+     * @param tuples Values of the tuples, one tuple after the other.
+     * @param count Number of tuples.
+     * @param columns Number of values of a tuple.
+     */
+    void insertBatch(const int *tuples, int count, int columns);
+    /**
+     * Delete tuples, as deleteTuple does one by one.
+     * @param tuples Values of the tuples, one tuple after the other.
+     * @param tupleIds Locations of the deleted tuples.
+     * @param count Number of tuples.
+     * @param columns Number of values of a tuple.
+     */
+    void deleteBatch(const int *tuples, const int *tupleIds, int count, int columns);
+    /**
+     * Query function, pass in expression, return estimated cardinality result.
+     * @param quals expression.
+     * @return return estimated cardinality result.
+     */
+    int query(const std::vector<CompareExpression>& quals);
+    /**
+     * Estimate many conjunctions at once. The range bounds of the conjunctions answered per column are sorted and
+     * answered in one pass over the synopsis of every column, and a predicate shared by conjunctions answered from the
+     * sample is evaluated once, into a bitmap the conjunctions intersect.
+     * @param batch Conjunctions.
+     * @param out Receives one estimated cardinality per conjunction.
+     */
+    void queryBatch(const std::vector<std::vector<CompareExpression>> &batch, std::vector<int> &out);
+    /**
+     * Preprocessing function of the cardinality estimation algorithm. This function is executed before each operation
+     * is called.
+     */
+    void prepare();
+    /**
+     * The constructor function of cardinality estimation.
+     * @param num Size of the initial data set.
+     * @param dataExecuter Interfaces for datasets.
+     */
+    CEEngine(int num, DataExecuter *dataExecuter);
+    /**
+     * The constructor function of cardinality estimation with explicit tuning parameters.
+     * @param num Size of the initial data set.
+     * @param dataExecuter Interfaces for datasets.
+     * @param config Budgets and sizes used by the engine.
+     */
+    CEEngine(int num, DataExecuter *dataExecuter, const EngineConfig &config);
+    ~CEEngine();
+    /**
+     * Save the statistics, so that a later engine can warm-start from them through EngineConfig::snapshotPath.
+     * @param path Snapshot file.
+     * @return return false if the file cannot be written.
+     */
+    bool saveSnapshot(const std::string &path) const;
+    /**
+     * Per-operation timings and the ring buffer of the last calls, as one JSON object. Empty unless the engine was
+     * built with CE_INSTRUMENT.
+     */
+    std::string statsJson() const;
+    /**
+     * Write statsJson() to a file; the destructor does the same with EngineConfig::statsPath.
+     * @return return false if the file cannot be written or the engine is not instrumented.
+     */
+    bool dumpStats(const std::string &path) const;
+    static bool isInstrumented()
+    {
+#ifdef CE_INSTRUMENT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // True if the configuration moves the histogram buckets and sketch counters between the columns by query share.
+    static bool adaptsBudget(const EngineConfig &config) { return config.memoryBudget > 0 && config.budgetInterval > 0; }
+
+    const BootstrapResult &getBootstrapResult() const { return bootstrap; }
+    const MaintenanceScheduler &getScheduler() const { return scheduler; }
+    const EstimateCache &getCache() const { return cache; }
+    const TupleBatchReader &getReader() const { return reader; }
+    const Arena &getArena() const { return arena; }
+    const DriftMonitor &getDriftMonitor() const { return drift; }
+    // Configuration in use, i.e. the one given to the constructor once sized to the memory budget.
+    const EngineConfig &getConfig() const { return config; }
+    MemoryUsage getMemoryUsage() const;
+    /**
+     * Number of EQUAL and of range predicates seen on a column since the last reallocation of the memory budget,
+     * older rounds counting half as much each.
+     */
+    long long equalHitsOf(int column) const { return equalHits[column]; }
+    long long rangeHitsOf(int column) const { return rangeHits[column]; }
+    // Buckets of the histogram and width of the sketch of a column, 0 without such an estimator.
+    int bucketCountOf(int column) const;
+    int sketchWidthOf(int column) const;
+    // True if the constructor loaded a snapshot instead of sampling the table.
+    bool isWarmStarted() const { return warmStarted; }
+
+private:
+    typedef double (CEEngine::*ShapePath)(const std::vector<CompareExpression> &quals);
+    static const ShapePath shapePaths[SHAPE_COUNT];
+
+    void startColumns(TupleRef tuple, int columns);
+    // Whether a tuple of columns values can be staged: it has the width of the engine, or is the first tuple seen.
+    bool acceptsWidth(int columns) const;
+    void countPredicates(const std::vector<CompareExpression> &quals);
+    void stage(TupleRef tuple, int tupleId, bool deleted);
+    void stageDelete(TupleRef tuple, int tupleId);
+    void applyStaged();
+    bool loadSnapshot(int num, int columns);
+    bool loadStatistics(SnapshotReader &in, int columns);
+    void resetStatistics();
+    void catchUp(int from, int num);
+    void ensureColumns(int columns);
+    void buildSynopses();
+    QueryShape shapeOf(const std::vector<CompareExpression> &quals) const;
+    double queryGeneric(const std::vector<CompareExpression> &quals);
+    template <int Columns, CompareOp First, CompareOp Second>
+    double queryShaped(const std::vector<CompareExpression> &quals);
+    void estimateBounds();
+    void countSampleBatch(const std::vector<std::vector<CompareExpression>> &batch, int first, int last);
+    double cachedEstimate(const std::vector<CompareExpression> &quals, QueryPlan plan);
+    double estimate(const std::vector<CompareExpression> &quals, QueryPlan plan);
+    QueryPlan choosePlan() const;
+    // Estimate of a range from the column summary alone, assuming uniform values.
+    double uniformEstimate(const ColumnRange &range) const;
+    double estimateRange(const ColumnRange &range) const;
+    double estimateGrid(const GridHistogram &grid) const;
+    const GridHistogram *findGrid(int first, int second) const;
+    void registerMaintenance();
+    bool stagingStep();
+    bool estimatorsStep();
+    bool refreshStep();
+    void cover(int start, int len);
+    bool driftStep();
+    bool cdfStep();
+    bool budgetStep();
+    void planBudget();
+    // True while nothing changed since the column scan of a task last found no work; see maintenanceVersion.
+    bool idleSince(long long idleVersion) const { return idleVersion == maintenanceVersion; }
+    std::vector<ColumnPlan> previewPlans(int num);
+    static size_t estimateArenaBytes(int num, const std::vector<ColumnPlan> &plans, const EngineConfig &config);
+    static size_t estimateBufferBytes(const EngineConfig &config);
+    static EngineConfig budgetConfig(int num, const std::vector<ColumnPlan> &plans, const EngineConfig &config);
+    static int tailCapacity(int num, const EngineConfig &config);
+    // The sample is stratified by location: the initial tuples, and the tail appended since the constructor.
+    bool inTail(int tupleId) const { return tupleId >= tailStart; }
+    bool sampleIsExact() const { return reservoir.isExact() && tail.isExact(); }
+    int sampleSize() const { return reservoir.size() + tail.size(); }
+    long long livePopulation() const { return reservoir.getPopulation() + tail.getPopulation(); }
+    static double weightOf(const Reservoir &stratum)
+    {
+        return stratum.size() == 0 ? 0 : (double)stratum.getPopulation() / stratum.size();
+    }
+    bool isDeleted(int tupleId) const
+    {
+        return tupleId < (int)tombstones.size() * 64 && ((tombstones[tupleId >> 6] >> (tupleId & 63)) & 1);
+    }
+
+    DataExecuter *dataExecuter;
+    EngineConfig config;
+    // Every statistic below is allocated from the arena, which is declared first so that it is destroyed last.
+    Arena arena;
+    std::mt19937_64 rng;
+    // Uniform samples of the initial tuples and of the inserted ones, weighted by their population when combined.
+    Reservoir reservoir;
+    Reservoir tail;
+    ArenaVector<ColumnSummary> summaries;
+    // One estimator of every ColumnPipeline type per column, e.g. a CDF model, which leaves its column to the next
+    // estimator when it did not fit.
+    ColumnPipeline columnEstimators;
+    ArenaVector<GridHistogram> grids;
+    // Index into grids of the pair (a, b), a < b, at gridOf[a * columns + b], or -1.
+    ArenaVector<int> gridOf;
+    BootstrapResult bootstrap;
+    // Selection bitmask and column ranges reused by every query.
+    std::vector<uint64_t> mask;
+    std::vector<ColumnRange> ranges;
+    // Scratch of queryBatch: column bounds, estimates, queries missing from the cache, queries answered from the
+    // sample with their distinct predicates and the masks of those, and the masks of one query.
+    std::vector<BatchBound> batchBounds;
+    std::vector<int> batchValues;
+    std::vector<double> batchGreater;
+    std::vector<double> batchEstimates;
+    std::vector<int> batchMissed;
+    std::vector<int> batchSample;
+    std::vector<CompareExpression> batchPredicates;
+    std::vector<uint64_t> batchMasks;
+    std::vector<const uint64_t *> batchRows;
+    MaintenanceScheduler scheduler;
+    EstimateCache cache;
+    DriftMonitor drift;
+    // Per-column count of modified tuples, and version of the column synopses, used to validate cached estimates.
+    ArenaVector<long long> columnEpochs;
+    ArenaVector<long long> columnVersions;
+    // One bit per tupleId, set once the tuple is deleted. It maps tuples returned by readTuples back to locations.
+    ArenaVector<uint64_t> tombstones;
+    // Inserted and deleted tuples not applied to the statistics yet, in arrival order: their values one tuple after the
+    // other, their locations, and whether they were deleted.
+    ArenaVector<int> stagedValues;
+    ArenaVector<int> stagedIds;
+    ArenaVector<uint8_t> stagedDeletes;
+    // Per-column predicate counters, and the bucket count and sketch width every column is moved to by the
+    // reallocation round in progress, 0 once done.
+    ArenaVector<long long> equalHits;
+    ArenaVector<long long> rangeHits;
+    ArenaVector<int> bucketTargets;
+    ArenaVector<int> widthTargets;
+    TupleBatchReader reader;
+#ifdef CE_INSTRUMENT
+    Instrumentation instrumentation;
+#endif
+    long long actions;
+    long long lastRefresh;
+    // Bumped whenever staged tuples are applied or a maintenance slice did work. The tasks that scan every column for
+    // work record it when the scan found none and are skipped until it moves, so an idle prepare() does not grow with
+    // the number of columns.
+    long long maintenanceVersion;
+    long long estimatorsIdle;
+    long long driftIdle;
+    long long cdfIdle;
+    // Column whose model is being refit, or -1.
+    int refitColumn;
+    // Queries since the last reallocation round, and the column the round in progress is at, or -1. A round first
+    // shrinks the synopses due to get smaller, then grows the others into the freed memory.
+    long long budgetQueries;
+    int budgetColumn;
+    bool budgetGrowing;
+    // Initial tuples, and the distinct ones read by the bootstrap and by refreshes. Coverage is kept per chunk of
+    // coverageChunk initial tuples, the length of a refresh, one bit per chunk read whole.
+    long long initialTuples;
+    long long coveredTuples;
+    int coverageChunk;
+    ArenaVector<uint64_t> coveredChunks;
+    // Inserted tuples are appended at the end of the disk, so their locations are handed out in order.
+    int nextTupleId;
+    // Location of the first tuple of the tail stratum.
+    int tailStart;
+    bool warmStarted;
+};
+
 #endif
\ No newline at end of file
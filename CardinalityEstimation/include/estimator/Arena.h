@@ -0,0 +1,168 @@
+#ifndef CARDINALITYESTIMATION_ARENA
+#define CARDINALITYESTIMATION_ARENA
+//
+// Memory arena holding all statistics of the engine.
+//
+
+#include <common/Root.h>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+/**
+ * Fixed-size slot pool carved out of an arena. Freed slots are kept on per-size free lists, so structures with churn
+ * such as hash nodes recycle their memory instead of growing the arena.
+ */
+class SlotPool {
+public:
+    static const int SLOT_ALIGN = 16;
+    static const int SIZE_CLASSES = 16;
+
+private:
+    void *freeLists[SIZE_CLASSES];
+
+public:
+    SlotPool();
+    // Size class of a slot of size bytes, or -1 if it is too large for the pool.
+    static int sizeClass(size_t bytes);
+    void *pop(int sizeClass);
+    void push(int sizeClass, void *slot);
+    void clear();
+};
+
+/**
+ * Monotonic arena. One block is reserved up front and allocations bump a pointer inside it; memory is only given back
+ * as a whole, when the arena is destroyed, so teardown does not depend on the number of allocations. The most recent
+ * allocation can also be released, which lets a vector grown in place reuse its old storage, and other released
+ * ranges of at least MIN_FREE_BYTES are kept for the best-fitting later allocation, so statistics resized at run time
+ * recycle their old storage. When the block is exhausted the arena falls back to extra blocks, so sizing it too small
+ * costs memory, never correctness.
+ */
+class Arena {
+public:
+    static const size_t MIN_FREE_BYTES = 256;
+
+private:
+    typedef struct FreeRange {
+        char *begin;
+        size_t bytes;
+    } FreeRange;
+    char *base;
+    size_t capacity;
+    size_t used;
+    size_t overflowBytes;
+    size_t freeBytes;
+    std::vector<char *> overflow;
+    std::vector<FreeRange> freeRanges;
+    SlotPool pool;
+
+    void *reuse(size_t bytes, size_t align);
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+public:
+    Arena();
+    ~Arena();
+    /**
+     * Reserve the block. Must be called before anything is allocated.
+     * @param bytes Size of the block.
+     */
+    void reserve(size_t bytes);
+    void *allocate(size_t bytes, size_t align);
+    void release(void *pointer, size_t bytes);
+    // Slot-pool allocation for single small objects; larger requests go to the arena.
+    void *allocateSlot(size_t bytes);
+    void releaseSlot(void *pointer, size_t bytes);
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+    size_t getOverflowBytes() const { return overflowBytes; }
+    // Bytes of released ranges waiting to be reused.
+    size_t getFreeBytes() const { return freeBytes; }
+    // True if an allocation of bytes can be served without falling back to an extra block.
+    bool fits(size_t bytes) const;
+};
+
+/**
+ * STL allocator drawing from an arena. A null arena falls back to the global heap, so containers that were never
+ * bound to an arena keep working.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    Arena *arena;
+
+    ArenaAllocator() : arena(nullptr) {}
+    ArenaAllocator(Arena *arena) : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+    {
+        if (arena == nullptr)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *pointer, size_t n)
+    {
+        if (arena == nullptr)
+            ::operator delete(pointer);
+        else
+            arena->release(pointer, n * sizeof(T));
+    }
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+/**
+ * Allocator for node-based containers: single objects come from the arena slot pool and are recycled, arrays come
+ * from the arena itself.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    Arena *arena;
+
+    PoolAllocator() : arena(nullptr) {}
+    PoolAllocator(Arena *arena) : arena(arena) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+    {
+        if (arena == nullptr)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        if (n == 1)
+            return static_cast<T *>(arena->allocateSlot(sizeof(T)));
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *pointer, size_t n)
+    {
+        if (arena == nullptr)
+            ::operator delete(pointer);
+        else if (n == 1)
+            arena->releaseSlot(pointer, sizeof(T));
+        else
+            arena->release(pointer, n * sizeof(T));
+    }
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef CARDINALITYESTIMATION_CDFMODEL
+#define CARDINALITYESTIMATION_CDFMODEL
+//
+// Piecewise-linear CDF model of one column, used for range selectivity on smooth distributions.
+//
+
+#include <common/Root.h>
+#include <estimator/Arena.h>
+#include <estimator/Snapshot.h>
+#include <estimator/SampleStore.h>
+#include <estimator/ColumnEstimator.h>
+
+/**
+ * Spline through the sorted sample of a column in the style of RadixSpline: knots are placed greedily so that the
+ * interpolated rank of every sampled value stays within an error bound of its true rank, relative to the nearer end
+ * of the sample, and a radix table on the
+ * high bits of the value narrows the search for the segment of a value to a few knots. An estimate thus costs a
+ * constant number of memory accesses.
+ * Updates do not move the knots. They are counted in a fixed number of correction bins, each holding an equal share
+ * of the modelled rows; an update only touches its bin, and fold() adds the bins up so that an estimate reads one
+ * prefix. Once enough rows changed, the knots are refit from the sample in slices: their positions are kept and
+ * their ranks are recounted, each sampled tuple weighted by the number of rows it stands for.
+ */
+class CdfModel : public ColumnEstimator<CdfModel> {
+public:
+    static const int CORRECTION_BINS = 64;
+
+private:
+    // Knot positions, ascending, and the share of the modelled rows at or below them.
+    ArenaVector<int> knotX;
+    ArenaVector<double> knotY;
+    // radix[p] is the first knot whose offset from origin, shifted right by shift, is at least p.
+    ArenaVector<int> radix;
+    long long origin;
+    int shift;
+    // Rows the knots describe; updates since the fit are kept apart as corrections.
+    double baseTotal;
+    // Corrections of the bins below every bin as of the last fold, and the ones since, with their sum.
+    ArenaVector<double> folded;
+    ArenaVector<double> pending;
+    double pendingSum;
+    bool dirty;
+    // Insertions and deletions since the knots were last fit.
+    long long changes;
+    // Refit in progress: weight of the sampled values in (knotX[k - 1], knotX[k]], the stratum and sample word read
+    // next, and the extreme values seen.
+    ArenaVector<double> hits;
+    bool refitting;
+    int stratum;
+    int cursor;
+    int lowestSeen;
+    int highestSeen;
+
+    double fraction(int value) const;
+    double greaterAt(double share) const;
+    int binOf(double share) const;
+    void buildRadix(int radixBits);
+    void update(int value, double delta);
+
+public:
+    CdfModel();
+    /**
+     * Fit the knots to a sample of the column.
+     * @param values Sampled values, ascending.
+     * @param scale Number of rows represented by one sampled value.
+     * @param error Greatest distance allowed between the interpolated and the true rank, as a share of the sampled
+     *        values between the value and the nearer end of the sample.
+     * @param maxKnots Number of knots beyond which the column is not considered smooth enough.
+     * @param radixBits Number of high bits of the value indexed by the radix table.
+     * @param arena Arena holding the model.
+     * @return return false if the column needs more than maxKnots knots; the model is then left unusable.
+     */
+    bool fit(const std::vector<int> &values, double scale, double error, int maxKnots, int radixBits, Arena *arena);
+    void insert(int value) { update(value, 1); }
+    void remove(int value) { update(value, -1); }
+    /**
+     * Fold the corrections of every bin into the prefixes read by greater().
+     */
+    void fold();
+    /**
+     * Estimate the number of rows whose value is greater than value. Corrections not folded yet only count for
+     * the bin of value.
+     */
+    double greater(int value) const;
+    /**
+     * Same as greater for many values at once, walking the knots instead of searching them.
+     * @param values Values, ascending.
+     * @param count Number of values.
+     * @param out Receives count estimates.
+     */
+    void greaterSorted(const int *values, int count, double *out) const;
+    /**
+     * Start recounting the knot ranks from the sample.
+     */
+    void startRefit();
+    /**
+     * Read the next slice of one stratum of the sample.
+     * @param store Sample store of the stratum.
+     * @param column Column of the model.
+     * @param weight Number of rows one sampled tuple of the stratum stands for.
+     * @param words Number of bitmap words read, 64 slots each.
+     * @return return true once the stratum is read through; the next call starts the next stratum.
+     */
+    bool scan(const SampleStore &store, int column, double weight, int words);
+    /**
+     * Replace the knot ranks with the recounted ones and clear the corrections.
+     */
+    void finishRefit();
+    // Snapshot of the model; load allocates from the arena and returns false on a malformed snapshot.
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+    bool usable() const { return knotX.size() >= 2; }
+    bool hasPending() const { return dirty; }
+    bool isRefitting() const { return refitting; }
+    int getStratum() const { return stratum; }
+    long long getChanges() const { return changes; }
+    int knotCount() const { return (int)knotX.size(); }
+    double getTotal() const { return usable() ? baseTotal + folded.back() + pendingSum : 0; }
+
+    // ColumnEstimator hooks. A model is fit only if config.cdfModel is set. A usable model answers the ranges that are
+    // not points, without the prior; maintenance folds all the corrections at once, which is not sliced.
+    static size_t arenaBytes(const EngineConfig &config);
+    void build(std::vector<int> &values, double scale, const EngineConfig &config, std::mt19937_64 &, Arena *arena)
+    {
+        if (config.cdfModel)
+            fit(values, scale, config.cdfError, config.cdfMaxKnots, config.cdfRadixBits, arena);
+    }
+    void onInsert(int value) { update(value, 1); }
+    void onDelete(int value) { update(value, -1); }
+    bool estimate(const ColumnRange &range, double prior, double &rows) const;
+    bool estimateSorted(const int *values, int count, double *out) const;
+    bool maintain(int)
+    {
+        if (!dirty)
+            return false;
+        fold();
+        return true;
+    }
+};
+
+#endif
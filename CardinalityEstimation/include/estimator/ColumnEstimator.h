@@ -0,0 +1,81 @@
+#ifndef CARDINALITYESTIMATION_COLUMNESTIMATOR
+#define CARDINALITYESTIMATION_COLUMNESTIMATOR
+//
+// Interface of the per-column estimators the engine is composed of.
+//
+
+#include <common/Root.h>
+#include <cstdint>
+#include <estimator/Arena.h>
+#include <estimator/ColumnRange.h>
+#include <estimator/EngineConfig.h>
+#include <estimator/Snapshot.h>
+
+/**
+ * CRTP base of an estimator kept for one column. Derived hides the hooks it implements; the defaults build nothing,
+ * take no memory and save nothing, ignore updates, answer no range and have no maintenance. Every call is resolved at
+ * compile time, so EstimatorPipeline composes estimators without virtual dispatch on the update and query paths.
+ */
+template <typename Derived>
+class ColumnEstimator {
+public:
+    /**
+     * Bytes the estimator of one column allocates from the arena, besides the estimator itself.
+     * @param config Configuration the estimator is built with.
+     */
+    static size_t arenaBytes(const EngineConfig &config) { return 0; }
+    /**
+     * Build the estimator from the sampled values of its column.
+     * @param values Sampled values, in ascending order, which they must stay in.
+     * @param scale Rows of the table one sampled value stands for.
+     * @param config Configuration of the engine.
+     * @param rng Random source of the engine.
+     * @param arena Arena holding the estimator.
+     */
+    void build(std::vector<int> &values, double scale, const EngineConfig &config, std::mt19937_64 &rng, Arena *arena)
+    {
+    }
+    // Snapshot of the estimator; load allocates from the arena and returns false on a malformed snapshot.
+    void save(SnapshotWriter &out) const {}
+    bool load(SnapshotReader &in, Arena *arena) { return true; }
+
+    void onInsert(int value) {}
+    void onDelete(int value) {}
+    /**
+     * Estimate the rows of the column in a range.
+     * @param range Range of the column.
+     * @param prior Estimate of the engine under uniformity, for estimators that only refine one.
+     * @param rows Receives the estimate.
+     * @return return false if the range is left to the next estimator.
+     */
+    bool estimate(const ColumnRange &range, double prior, double &rows) const { return false; }
+    /**
+     * Estimate the rows greater than each of values, sorted in ascending order, or return false as estimate does.
+     */
+    bool estimateSorted(const int *values, int count, double *out) const { return false; }
+    /**
+     * One slice of the maintenance the estimator does without the sample, of at most slice units of work.
+     * @return return true if there was work.
+     */
+    bool maintain(int slice) { return false; }
+
+    /**
+     * Apply staged tuples in arrival order.
+     * @param values Value of the column in the first tuple; the next tuple is stride values further.
+     * @param deleted Whether each tuple was deleted, or inserted.
+     * @param count Number of tuples.
+     * @param stride Number of values of a tuple.
+     */
+    void applyBatch(const int *values, const uint8_t *deleted, int count, int stride)
+    {
+        Derived &self = static_cast<Derived &>(*this);
+        for (int k = 0; k < count; ++k) {
+            if (deleted[k])
+                self.onDelete(values[(size_t)k * stride]);
+            else
+                self.onInsert(values[(size_t)k * stride]);
+        }
+    }
+};
+
+#endif
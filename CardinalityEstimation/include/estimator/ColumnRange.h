@@ -0,0 +1,43 @@
+#ifndef CARDINALITYESTIMATION_COLUMNRANGE
+#define CARDINALITYESTIMATION_COLUMNRANGE
+//
+// Reduction of a conjunction of predicates to one value range per column.
+//
+
+#include <common/Root.h>
+#include <common/Expression.h>
+
+/**
+ * A struct for the inclusive range [from, to] of values accepted by the predicates on one column.
+ */
+typedef struct ColumnRange {
+    int column;
+    long long from;
+    long long to;
+
+    bool isPoint() const { return from == to; }
+    bool isEmpty() const { return from > to; }
+} ColumnRange;
+
+/**
+ * Range of a single predicate whose operator is known at compile time.
+ * @param expr Predicate.
+ * @return return the values accepted by expr. A GREATER on INT32_MAX gives an empty range.
+ */
+template <CompareOp Op>
+inline ColumnRange rangeOf(const CompareExpression &expr)
+{
+    if (Op == EQUAL)
+        return {expr.columnIdx, (long long)expr.value, (long long)expr.value};
+    return {expr.columnIdx, (long long)expr.value + 1, (long long)INT32_MAX};
+}
+
+/**
+ * Intersect the predicates of quals column by column.
+ * @param quals Conjunction of predicates.
+ * @param ranges Receives one range per distinct column, sorted by column.
+ * @return return false if some column range is empty, so the conjunction matches nothing.
+ */
+bool reduceQuals(const std::vector<CompareExpression> &quals, std::vector<ColumnRange> &ranges);
+
+#endif
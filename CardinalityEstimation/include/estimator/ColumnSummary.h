@@ -0,0 +1,39 @@
+#ifndef CARDINALITYESTIMATION_COLUMNSUMMARY
+#define CARDINALITYESTIMATION_COLUMNSUMMARY
+//
+// Per-column summary statistics.
+//
+
+#include <common/Root.h>
+
+/**
+ * A struct for the summary of one column. min and max cover every tuple that was read, ndv is an estimate of the
+ * number of distinct values in the whole data set.
+ */
+typedef struct ColumnSummary {
+    int min = 0;
+    int max = 0;
+    long long count = 0;
+    double ndv = 1;
+
+    void add(int value)
+    {
+        if (count == 0 || value < min)
+            min = value;
+        if (count == 0 || value > max)
+            max = value;
+        count++;
+    }
+} ColumnSummary;
+
+/**
+ * Estimate the number of distinct values of a column from a uniform sample with Shlosser's estimator,
+ * d + f1 * sum((1 - q)^i * fi) / sum(i * q * (1 - q)^(i - 1) * fi) where q = n / N. It is exact both for an all-distinct
+ * column and for a column whose values were all seen several times.
+ * @param values Sampled values of the column. The vector is sorted in place.
+ * @param population Number of tuples the sample was drawn from.
+ * @return return estimated number of distinct values, at least 1.
+ */
+double estimateDistinct(std::vector<int> &values, long long population);
+
+#endif
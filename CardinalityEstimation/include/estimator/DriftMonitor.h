@@ -0,0 +1,94 @@
+#ifndef CARDINALITYESTIMATION_DRIFTMONITOR
+#define CARDINALITYESTIMATION_DRIFTMONITOR
+//
+// Drift detection between the reservoir sample and the per-column histograms.
+//
+
+#include <common/Root.h>
+#include <estimator/Arena.h>
+#include <estimator/EquiDepthHistogram.h>
+#include <estimator/SampleStore.h>
+
+/**
+ * Tracks the insertions and deletions applied since every column was last checked, and checks a column by comparing
+ * the CDF of its sampled values with the CDF of its histogram at every bucket bound and bucket middle, a KS-style
+ * distance. The sample stays uniform under updates while a histogram only counts them, so a large distance at a
+ * bucket middle means the uniform spread assumed inside that bucket no longer holds. A check reads the sample in
+ * slices, so it can run inside the prepare() budget, one stratum after the other, each sampled tuple weighted by the
+ * number of rows it stands for.
+ */
+class DriftMonitor {
+private:
+    long long inserts;
+    long long deletes;
+    // Counters as they were when every column was last checked, and the distance that check measured.
+    ArenaVector<long long> insertsAt;
+    ArenaVector<long long> deletesAt;
+    ArenaVector<double> distances;
+    // Column being checked, or -1, the stratum and sample word read next, and the next column considered for a check.
+    int column;
+    int stratum;
+    int cursor;
+    int nextColumn;
+    // Bucket middles and bounds of the checked column, ascending, point 2b at the middle of bucket b and point 2b + 1
+    // at its upper bound, and the weight of the sampled values in (points[i - 1], points[i]], with their number.
+    ArenaVector<int> points;
+    ArenaVector<double> hits;
+    ArenaVector<int> samples;
+    // Lower bound of the first bucket when the check started.
+    long long lowest;
+    long long checks;
+    long long repairs;
+
+public:
+    DriftMonitor();
+    /**
+     * Allocate the counters. Must be called once the number of columns is known.
+     * @param columns Number of columns.
+     * @param buckets Number of buckets of a histogram.
+     * @param arena Arena holding the counters.
+     */
+    void init(int columns, int buckets, Arena *arena);
+    void recordInsert() { inserts++; }
+    void recordDelete() { deletes++; }
+    /**
+     * Choose the next column whose tuples changed enough since its last check.
+     * @param minChanges Number of insertions and deletions after which a column is due.
+     * @return return the column, or -1 if none is due.
+     */
+    int due(long long minChanges) const;
+    /**
+     * Start checking a column against its histogram.
+     */
+    void start(int column, const EquiDepthHistogram &histogram);
+    /**
+     * Read the next slice of the current stratum for the column being checked, moving to the next stratum once it is
+     * read entirely.
+     * @param store Sample store of the stratum returned by getStratum().
+     * @param weight Number of rows one sampled tuple of the stratum stands for.
+     * @param words Number of bitmap words, 64 slots each, read by the slice.
+     * @return return true once the stratum has been read.
+     */
+    bool scan(const SampleStore &store, double weight, int words);
+    /**
+     * Finish the check: measure the distance and, if it exceeds the threshold, split the buckets whose sampled values
+     * disagree most with the uniform spread, as long as they still have the bounds they had when the check started.
+     * A repaired column stays due while its distance keeps decreasing, so it is checked again after the repair.
+     * @param histogram Histogram of the checked column.
+     * @param threshold Distance, as a fraction of the rows, above which the column is repaired.
+     * @param maxRepairs Maximum number of buckets split.
+     * @return return the number of buckets split.
+     */
+    int finish(EquiDepthHistogram &histogram, double threshold, int maxRepairs);
+    bool checking() const { return column >= 0; }
+    int getColumn() const { return column; }
+    int getStratum() const { return stratum; }
+    long long insertsSince(int c) const { return inserts - insertsAt[c]; }
+    long long deletesSince(int c) const { return deletes - deletesAt[c]; }
+    // Distance measured by the last check of a column, 0 if it was never checked.
+    double getDistance(int c) const { return distances[c]; }
+    long long getChecks() const { return checks; }
+    long long getRepairs() const { return repairs; }
+};
+
+#endif
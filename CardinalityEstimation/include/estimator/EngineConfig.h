@@ -0,0 +1,104 @@
+#ifndef CARDINALITYESTIMATION_ENGINECONFIG
+#define CARDINALITYESTIMATION_ENGINECONFIG
+//
+// Tunable parameters of the cardinality estimation engine.
+//
+
+#include <common/Root.h>
+#include <cstddef>
+#include <string>
+
+/**
+ * An enum stands for the way the bootstrap chooses the chunks it reads.
+ * EVEN_SPACED reads the first block of every stratum, BLOCK_RANDOM reads one random block of every stratum.
+ */
+enum BootstrapMode { EVEN_SPACED = 0, BLOCK_RANDOM = 1 };
+
+/**
+ * A struct for the engine configuration. The defaults are the values used by CEEngine(num, dataExecuter).
+ */
+typedef struct EngineConfig {
+    // Maximum number of tuples read through readTuples while the constructor runs.
+    int bootstrapTupleBudget = 1 << 20;
+    // Maximum time spent reading in the constructor, in milliseconds.
+    int bootstrapTimeBudgetMs = 200;
+    // Number of tuples requested by a single readTuples call.
+    int bootstrapChunkSize = 4096;
+    BootstrapMode bootstrapMode = BLOCK_RANDOM;
+    // Cache size a readTuples batch is capped to, in bytes.
+    int readerCacheBytes = 512 * 1024;
+    // Maximum number of tuples kept in the reservoir sample.
+    int sampleCapacity = 1 << 17;
+    // Share of the sample capacity that goes to the stratum of the tuples inserted after the constructor. The old
+    // stratum hands over one slot for every tuple the recent stratum takes, so the sample never grows.
+    double tailShare = 0.125;
+    // Whether sampled columns are stored as 1- or 2-byte codes where the first values read allow it. Codes widen on
+    // their own when a later value does not fit, so this only trades memory and scan bandwidth.
+    bool packSample = true;
+    // Number of buckets of every per-column equi-depth histogram.
+    int histogramBuckets = 256;
+    // A histogram bucket is split once it holds more than this multiple of the average bucket count.
+    double histogramSplitThreshold = 2.0;
+    // Range predicates on a column are estimated from a piecewise-linear CDF model instead of the histogram when the
+    // model follows every sampled rank within cdfError of the distance to the nearer end of the sample, or within the
+    // sampling noise if larger, with fewer than cdfMaxKnots knots. The knots are
+    // found through a radix table on the cdfRadixBits high bits of the value. Once cdfRefitFraction of the modelled
+    // rows were inserted or deleted, the knots are recounted from the sample, cdfSlice sampled tuples per slice.
+    bool cdfModel = true;
+    double cdfError = 0.003;
+    int cdfMaxKnots = 1024;
+    int cdfRadixBits = 10;
+    double cdfRefitFraction = 0.05;
+    int cdfSlice = 256;
+    // Shape of every per-column Count-Min sketch and size of its heavy-hitters table.
+    int sketchDepth = 4;
+    int sketchWidth = 4096;
+    int heavyHitters = 64;
+    // Grid histograms are kept for every pair among the first gridColumns columns, with gridCells cells per side.
+    int gridColumns = 8;
+    int gridCells = 32;
+    // Inserted and deleted tuples are staged and applied to the statistics in one pass per synopsis. The pass runs
+    // when stagingCapacity tuples are staged, as a prepare() slice once half as many are, and before every query.
+    int stagingCapacity = 64;
+    // Budget of one prepare() call: at most prepareMaxSteps maintenance slices, and no new slice after
+    // prepareBudgetUs microseconds.
+    int prepareMaxSteps = 4;
+    double prepareBudgetUs = 20;
+    // Every refreshInterval actions, a chunk of refreshChunk tuples is reread to refresh part of the sample, as long as
+    // less than refreshCoverage of the initial tuples were ever read, each tuple counted once however often it was.
+    // A sample drawn from a full scan is never reread.
+    int refreshInterval = 64;
+    int refreshChunk = 64;
+    double refreshCoverage = 0.99;
+    // A column is checked for drift once driftCheckFraction of the live rows were inserted or deleted since its last
+    // check, reading driftSlice sampled tuples per maintenance slice. When the distance between the sample and the
+    // histogram exceeds driftThreshold, or the sampling noise if larger, up to driftRepairs buckets are split.
+    double driftCheckFraction = 0.05;
+    int driftSlice = 128;
+    double driftThreshold = 0.01;
+    int driftRepairs = 4;
+    // Slice every column estimator is given per maintenance step, i.e. the number of heavy-hitter entries a sketch
+    // checks against its counters.
+    int compactSlice = 16;
+    // Number of cached query estimates, and the fraction of the live rows that may change before one is recomputed.
+    int cacheEntries = 1024;
+    double cacheTolerance = 0.002;
+    // Memory the engine may use, in bytes, or 0 for no limit. The constructor shrinks the sizes above, in turn, until
+    // the statistics and the buffers they are built with fit, dropping the grids and the CDF models if it must; what
+    // the engine actually uses is reported by CEEngine::getMemoryUsage. Under a budget the histogram buckets and the
+    // sketch counters are also moved between the columns every budgetInterval queries, by the share of the range and
+    // equality predicates each column got, so that a column queried more gets finer synopses.
+    size_t memoryBudget = 0;
+    int budgetInterval = 4096;
+    // Seed of every random decision taken by the engine, so that runs are reproducible.
+    unsigned long long seed = 0x5eedULL;
+    // Snapshot the constructor warm-starts from, if set. It is used when it was taken on the same table shape and
+    // configuration and at most snapshotCatchUpLimit tuples were appended since; otherwise statistics are rebuilt.
+    std::string snapshotPath;
+    int snapshotCatchUpLimit = 1 << 18;
+    // File the instrumentation stats are written to when the engine is destroyed, if set. Only used in builds with
+    // CE_INSTRUMENT.
+    std::string statsPath;
+} EngineConfig;
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef CARDINALITYESTIMATION_EQUIDEPTHHISTOGRAM
+#define CARDINALITYESTIMATION_EQUIDEPTHHISTOGRAM
+//
+// Equi-depth histogram of one column, used for range selectivity.
+//
+
+#include <common/Root.h>
+#include <estimator/Arena.h>
+#include <estimator/Snapshot.h>
+#include <estimator/SampleStore.h>
+#include <estimator/ColumnEstimator.h>
+
+/**
+ * Bucket i covers the values in (upper[i - 1], upper[i]], bucket 0 covers [lower, upper[0]]. Counts are kept in a
+ * Fenwick tree so that both counter updates and GREATER estimates cost O(log B). Inside a bucket the values are
+ * assumed to be spread uniformly.
+ */
+class EquiDepthHistogram : public ColumnEstimator<EquiDepthHistogram> {
+private:
+    int lower;
+    ArenaVector<int> upper;
+    ArenaVector<double> counts;
+    ArenaVector<double> tree;
+    double total;
+    double splitThreshold;
+    // Set when a counter update pushed a bucket past the split threshold.
+    bool unbalanced;
+    // Number of bucket splits, so that a resize can tell whether the buckets it started from are still there.
+    long long splits;
+    // Resize in progress: upper bounds of the new buckets, the weight of the sampled values in each, the number of
+    // splits when it started, and the stratum and sample word read next.
+    ArenaVector<int> nextUpper;
+    ArenaVector<double> nextHits;
+    long long resizeSplits;
+    bool growing;
+    int stratum;
+    int cursor;
+
+    int bucketOf(int value) const;
+    void add(int bucket, double delta);
+    double prefix(int buckets) const;
+    void rebuildTree();
+    void merge(int buckets);
+
+public:
+    EquiDepthHistogram();
+    /**
+     * Build the buckets from a sample of the column.
+     * @param values Sampled values. The vector is sorted in place.
+     * @param scale Number of tuples represented by one sampled value.
+     * @param buckets Target number of buckets.
+     * @param splitThreshold A bucket is split once its count exceeds this multiple of the average bucket count.
+     * @param arena Arena holding the buckets.
+     */
+    void build(std::vector<int> &values, double scale, int buckets, double splitThreshold, Arena *arena);
+    void insert(int value);
+    void remove(int value);
+    // Snapshot of the buckets; load allocates from the arena and returns false on a malformed snapshot.
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+    /**
+     * Split the heaviest bucket above the split threshold, if any. Splits cost O(B), so they are left to the
+     * maintenance scheduler instead of being done by insert.
+     * @return return true if a bucket was split.
+     */
+    bool rebalance();
+    bool needsRebalance() const { return unbalanced; }
+    /**
+     * Split a bucket in two and keep the bucket count constant by merging the lightest adjacent pair elsewhere.
+     * @param bucket Bucket to split.
+     * @param at Upper bound of the first half, strictly inside the value range of the bucket.
+     * @param share Fraction of the bucket count given to the first half.
+     * @return return false if at does not split the bucket.
+     */
+    bool splitBucket(int bucket, int at, double share);
+    /**
+     * Change the number of buckets. Fewer buckets are obtained at once, by merging adjacent buckets at the equi-depth
+     * cuts. More buckets are obtained by splitting every bucket evenly over its value range into as many parts as its
+     * count deserves; the parts get their share of its count from the sample, read in slices by scan, once
+     * finishResize runs.
+     * @param buckets Target number of buckets.
+     * @param arena Arena holding the new buckets.
+     * @return return true if the sample has to be scanned before finishResize.
+     */
+    bool startResize(int buckets, Arena *arena);
+    /**
+     * Read the next slice of the current stratum for the resize in progress, as CdfModel::scan does for a refit.
+     * @param store Sample store of the stratum returned by getStratum().
+     * @param column Column of the histogram in the store.
+     * @param weight Number of rows one sampled tuple of the stratum stands for.
+     * @param words Number of bitmap words, 64 slots each, read by the slice.
+     * @return return true once the stratum has been read.
+     */
+    bool scan(const SampleStore &store, int column, double weight, int words);
+    /**
+     * Replace the buckets by the split ones. The counts of the old buckets are kept, and spread over their parts like
+     * the sampled values.
+     * @return return false if a bucket was split since startResize, in which case the resize is dropped.
+     */
+    bool finishResize();
+    bool resizing() const { return growing; }
+    int getStratum() const { return stratum; }
+    /**
+     * Estimate the number of tuples whose value is greater than value.
+     */
+    double greater(int value) const;
+    /**
+     * Same as greater, to the last bit, for many values at once, finding their buckets in one pass over the bounds.
+     * @param values Values, ascending.
+     * @param count Number of values.
+     * @param out Receives count estimates.
+     */
+    void greaterSorted(const int *values, int count, double *out) const;
+    bool empty() const { return upper.empty(); }
+    int bucketCount() const { return (int)upper.size(); }
+    // Value range (lowerOf(bucket), upperOf(bucket)] of a bucket, and its count.
+    long long lowerOf(int bucket) const { return bucket == 0 ? (long long)lower - 1 : upper[bucket - 1]; }
+    int upperOf(int bucket) const { return upper[bucket]; }
+    double countOf(int bucket) const { return counts[bucket]; }
+    double getTotal() const { return total; }
+
+    // ColumnEstimator hooks. The histogram answers every range, points included, once it is built, without the prior;
+    // maintenance is one rebalance, a single bucket split that is not sliced and that would drop a resize in progress.
+    static size_t arenaBytes(const EngineConfig &config);
+    void build(std::vector<int> &values, double scale, const EngineConfig &config, std::mt19937_64 &, Arena *arena)
+    {
+        build(values, scale, config.histogramBuckets, config.histogramSplitThreshold, arena);
+    }
+    void onInsert(int value) { insert(value); }
+    void onDelete(int value) { remove(value); }
+    bool estimate(const ColumnRange &range, double prior, double &rows) const;
+    bool estimateSorted(const int *values, int count, double *out) const;
+    bool maintain(int) { return unbalanced && !growing && rebalance(); }
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef CARDINALITYESTIMATION_ESTIMATECACHE
+#define CARDINALITYESTIMATION_ESTIMATECACHE
+//
+// Cache of query estimates keyed by the normalized form of their quals.
+//
+
+#include <common/Root.h>
+#include <cstdint>
+#include <estimator/ColumnRange.h>
+#include <estimator/Arena.h>
+
+/**
+ * Direct-mapped cache of estimates. The key of a query is the list of column ranges produced by reduceQuals, which
+ * already sorts predicates by column and merges duplicates, so equivalent quals share an entry. Entries are never
+ * invalidated eagerly: every entry keeps the epoch and version of its columns, and a lookup accepts it while the
+ * tuples modified since then stay within a tolerance of the live rows and no synopsis of its columns was rebuilt.
+ */
+class EstimateCache {
+public:
+    // Queries on more columns are not cached.
+    static const int MAX_COLUMNS = 4;
+
+private:
+    typedef struct Entry {
+        uint64_t hash;
+        int columns;
+        ColumnRange ranges[MAX_COLUMNS];
+        long long epochs[MAX_COLUMNS];
+        long long versions[MAX_COLUMNS];
+        double rows;
+        double estimate;
+    } Entry;
+    ArenaVector<Entry> entries;
+    uint64_t slotMask;
+    double tolerance;
+    long long hits;
+    long long misses;
+
+public:
+    EstimateCache();
+    /**
+     * @param entries Number of entries, rounded up to a power of two. 0 disables the cache.
+     * @param tolerance Fraction of the live rows that may be modified before an entry is recomputed.
+     * @param arena Arena holding the entries.
+     */
+    void init(int entries, double tolerance, Arena *arena);
+    static uint64_t hashKey(const std::vector<ColumnRange> &key);
+    /**
+     * Look up an estimate.
+     * @param hash Hash of key.
+     * @param key Normalized quals.
+     * @param epochs Per-column modification counters.
+     * @param versions Per-column synopsis versions.
+     * @param rows Current number of live rows.
+     * @param estimate Receives the cached estimate, rescaled to the current number of rows.
+     * @return return true on a valid hit.
+     */
+    bool lookup(uint64_t hash, const std::vector<ColumnRange> &key, const long long *epochs, const long long *versions,
+                double rows, double &estimate);
+    void store(uint64_t hash, const std::vector<ColumnRange> &key, const long long *epochs, const long long *versions,
+               double rows, double estimate);
+    static size_t entryBytes() { return sizeof(Entry); }
+    bool enabled() const { return !entries.empty(); }
+    long long getHits() const { return hits; }
+    long long getMisses() const { return misses; }
+};
+
+#endif
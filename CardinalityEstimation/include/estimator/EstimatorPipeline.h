@@ -0,0 +1,216 @@
+#ifndef CARDINALITYESTIMATION_ESTIMATORPIPELINE
+#define CARDINALITYESTIMATION_ESTIMATORPIPELINE
+//
+// Static composition of per-column estimators.
+//
+
+#include <common/Root.h>
+#include <tuple>
+#include <type_traits>
+#include <estimator/Arena.h>
+#include <estimator/ColumnEstimator.h>
+
+/**
+ * Pipeline of ColumnEstimator types, fixed at compile time. Every stage is a vector holding one estimator per column,
+ * built, sized, saved and maintained through the hooks of ColumnEstimator, so that adding an estimator only takes
+ * adding its type to the list. Updates go to every stage, and a range is offered to the stages in order until one
+ * answers it.
+ */
+template <typename... Stages>
+class EstimatorPipeline {
+private:
+    std::tuple<ArenaVector<Stages>...> stages;
+
+    template <typename Stage>
+    static void applyTo(ArenaVector<Stage> &estimators, const int *values, const uint8_t *deleted, int count,
+                        int columns)
+    {
+        for (int c = 0; c < (int)estimators.size(); ++c)
+            estimators[c].applyBatch(values + c, deleted, count, columns);
+    }
+
+    template <typename Stage>
+    static bool estimateWith(const ArenaVector<Stage> &estimators, const ColumnRange &range, double prior,
+                             double &rows)
+    {
+        return range.column < (int)estimators.size() && estimators[range.column].estimate(range, prior, rows);
+    }
+
+    template <typename Stage>
+    static bool estimateSortedWith(const ArenaVector<Stage> &estimators, int column, const int *values, int count,
+                                   double *out)
+    {
+        return column < (int)estimators.size() && estimators[column].estimateSorted(values, count, out);
+    }
+
+    template <typename Stage>
+    static void saveStage(const ArenaVector<Stage> &estimators, SnapshotWriter &out)
+    {
+        out.put((int)estimators.size());
+        for (int c = 0; c < (int)estimators.size(); ++c)
+            estimators[c].save(out);
+    }
+
+    // Every stage must hold as many estimators as the first one, at most columns.
+    template <typename Stage>
+    static bool loadStage(ArenaVector<Stage> &estimators, SnapshotReader &in, int columns, int &expected,
+                          Arena *arena)
+    {
+        int count = 0;
+        if (!in.get(count) || count < 0 || count > columns || (expected >= 0 && count != expected))
+            return false;
+        expected = count;
+        estimators.assign(count, Stage());
+        for (int c = 0; c < count; ++c) {
+            if (!estimators[c].load(in, arena))
+                return false;
+        }
+        return true;
+    }
+
+public:
+    static_assert(sizeof...(Stages) > 0, "a pipeline needs at least one estimator");
+
+    explicit EstimatorPipeline(Arena *arena) : stages(ArenaVector<Stages>(ArenaAllocator<Stages>(arena))...) {}
+
+    template <typename Stage>
+    static constexpr bool contains()
+    {
+        return (std::is_same<Stage, Stages>::value || ...);
+    }
+
+    /**
+     * Estimators of the stage of type Stage, one per column, or null if the pipeline has no such stage. Lets the
+     * engine reach what only one estimator does, e.g. rebuilding a histogram with more buckets.
+     */
+    template <typename Stage>
+    ArenaVector<Stage> *find()
+    {
+        if constexpr (contains<Stage>())
+            return &std::get<ArenaVector<Stage>>(stages);
+        else
+            return nullptr;
+    }
+
+    template <typename Stage>
+    const ArenaVector<Stage> *find() const
+    {
+        if constexpr (contains<Stage>())
+            return &std::get<ArenaVector<Stage>>(stages);
+        else
+            return nullptr;
+    }
+
+    /**
+     * Bytes the estimators of one column take in the arena.
+     * @param config Configuration the estimators are built with.
+     */
+    static size_t arenaBytes(const EngineConfig &config)
+    {
+        return ((sizeof(Stages) + Stages::arenaBytes(config)) + ...);
+    }
+
+    // Bytes of the stage of type Stage for one column, 0 if the pipeline has no such stage.
+    template <typename Stage>
+    static size_t arenaBytesOf(const EngineConfig &config)
+    {
+        if constexpr (contains<Stage>())
+            return Stage::arenaBytes(config);
+        else
+            return 0;
+    }
+
+    // Number of columns the stages have estimators for.
+    int columns() const { return (int)std::get<0>(stages).size(); }
+
+    /**
+     * Give every stage one empty estimator per column, dropping the current ones.
+     * @param columns Number of columns.
+     */
+    void reset(int columns)
+    {
+        (std::get<ArenaVector<Stages>>(stages).assign(columns, Stages()), ...);
+    }
+
+    void clear()
+    {
+        (std::get<ArenaVector<Stages>>(stages).clear(), ...);
+    }
+
+    /**
+     * Build the estimators of a column, in stage order, from its sampled values.
+     * @param column Column index, below columns().
+     * @param values Sampled values of the column, in ascending order, which they must stay in.
+     * @param scale Rows of the table one sampled value stands for.
+     * @param config Configuration of the engine.
+     * @param rng Random source of the engine.
+     * @param arena Arena holding the estimators.
+     */
+    void build(int column, std::vector<int> &values, double scale, const EngineConfig &config, std::mt19937_64 &rng,
+               Arena *arena)
+    {
+        (std::get<ArenaVector<Stages>>(stages)[column].build(values, scale, config, rng, arena), ...);
+    }
+
+    /**
+     * Apply staged tuples to every stage, one stage and one column at a time.
+     * @param values Values of the tuples, one tuple after the other.
+     * @param deleted Whether each tuple was deleted, or inserted.
+     * @param count Number of tuples.
+     * @param columns Number of values of a tuple.
+     */
+    void apply(const int *values, const uint8_t *deleted, int count, int columns)
+    {
+        (applyTo(std::get<ArenaVector<Stages>>(stages), values, deleted, count, columns), ...);
+    }
+
+    /**
+     * One slice of the maintenance of every estimator of a column.
+     * @param column Column index, below columns().
+     * @param slice Units of work each estimator may do.
+     * @return return true if some estimator had work, which may change the estimates of the column.
+     */
+    bool maintain(int column, int slice)
+    {
+        bool work = false;
+        ((work |= std::get<ArenaVector<Stages>>(stages)[column].maintain(slice)), ...);
+        return work;
+    }
+
+    /**
+     * Estimate the rows in a range from the first stage that answers it.
+     * @return return false if no stage does.
+     */
+    bool estimate(const ColumnRange &range, double prior, double &rows) const
+    {
+        return (estimateWith(std::get<ArenaVector<Stages>>(stages), range, prior, rows) || ...);
+    }
+
+    /**
+     * Estimate the rows of a column greater than each of values, sorted, from the first stage that answers them.
+     * @return return false if no stage does.
+     */
+    bool estimateSorted(int column, const int *values, int count, double *out) const
+    {
+        return (estimateSortedWith(std::get<ArenaVector<Stages>>(stages), column, values, count, out) || ...);
+    }
+
+    // Snapshot of every stage, in stage order; load allocates from the arena and returns false on a malformed
+    // snapshot, one of another composition or one of more than columns columns.
+    void save(SnapshotWriter &out) const
+    {
+        out.put((int)sizeof...(Stages));
+        (saveStage(std::get<ArenaVector<Stages>>(stages), out), ...);
+    }
+
+    bool load(SnapshotReader &in, int columns, Arena *arena)
+    {
+        int count = 0;
+        if (!in.get(count) || count != (int)sizeof...(Stages))
+            return false;
+        int expected = -1;
+        return (loadStage(std::get<ArenaVector<Stages>>(stages), in, columns, expected, arena) && ...);
+    }
+};
+
+#endif
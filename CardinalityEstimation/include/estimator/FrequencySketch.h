@@ -0,0 +1,190 @@
+#ifndef CARDINALITYESTIMATION_FREQUENCYSKETCH
+#define CARDINALITYESTIMATION_FREQUENCYSKETCH
+//
+// Fixed-memory frequency synopses of one column, used for EQUAL selectivity.
+//
+
+#include <common/Root.h>
+#include <cstdint>
+#include <estimator/Arena.h>
+#include <estimator/Snapshot.h>
+#include <estimator/SampleStore.h>
+#include <estimator/ColumnEstimator.h>
+
+/**
+ * Count-Min sketch with conservative update on increments. Decrements subtract from every row and saturate at zero,
+ * so after deletions an estimate can undershoot; the mean-corrected estimate used by query() tolerates that.
+ */
+class CountMinSketch {
+private:
+    int depth;
+    int shift;
+    long long total;
+    ArenaVector<uint64_t> multipliers;
+    ArenaVector<uint32_t> counters;
+
+    int cell(int row, int value) const
+    {
+        uint64_t h = multipliers[row] * ((uint64_t)(uint32_t)value + 1);
+        return (int)(h >> shift);
+    }
+
+public:
+    CountMinSketch();
+    /**
+     * @param depth Number of hash rows.
+     * @param width Counters per row, rounded up to a power of two.
+     * @param rng Source of the hash multipliers.
+     * @param arena Arena holding the counters.
+     */
+    void init(int depth, int width, std::mt19937_64 &rng, Arena *arena);
+    void add(int value, uint32_t weight);
+    void subtract(int value, uint32_t weight);
+    // Smallest counter of value, an upper bound of its frequency while no deletion happened.
+    uint32_t upperBound(int value) const;
+    // Count-Mean-Min estimate: every row's counter minus the expected collision noise, median over the rows.
+    double estimate(int value) const;
+    // Standard deviation of the collision count of a counter.
+    double noise() const;
+    /**
+     * Halve the rows until they are width counters wide. A cell of the narrower sketch covers adjacent cells of the
+     * wider one, so their sum is exactly the counter the narrower sketch would hold, up to the conservative update.
+     * @param width Counters per row, a power of two below the current width.
+     * @param arena Arena holding the counters.
+     */
+    void fold(int width, Arena *arena);
+    bool empty() const { return counters.empty(); }
+    int getDepth() const { return depth; }
+    int getWidth() const { return counters.empty() ? 0 : 1 << (64 - shift); }
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+    long long getTotal() const { return total; }
+};
+
+/**
+ * SpaceSaving table of the k most frequent values. A monitored value with count c and error e occurs between c - e and
+ * c times. The table is small, so lookups are a linear scan over a contiguous value array and need no allocation.
+ */
+class HeavyHitters {
+private:
+    int capacity;
+    ArenaVector<int> values;
+    ArenaVector<long long> counts;
+    ArenaVector<long long> errors;
+
+    int slotOf(int value) const;
+
+public:
+    HeavyHitters();
+    void init(int capacity, Arena *arena);
+    void add(int value, long long weight);
+    void subtract(int value, long long weight);
+    /**
+     * @param value Looked up value.
+     * @param lowerBound Receives the guaranteed count.
+     * @param upperBound Receives the maximum count.
+     * @return return true if the value is monitored.
+     */
+    bool find(int value, long long &lowerBound, long long &upperBound) const;
+    /**
+     * Lower the counts of a slice of the monitored values to the upper bound given by a Count-Min sketch, so values
+     * whose tuples were deleted become replaceable again.
+     * @param sketch Sketch fed with the same stream.
+     * @param begin First entry of the slice.
+     * @param count Number of entries in the slice.
+     * @return return the entry following the slice, 0 once the table was walked through.
+     */
+    int tighten(const CountMinSketch &sketch, int begin, int count);
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+};
+
+/**
+ * Count-Min sketch paired with a heavy-hitters table.
+ */
+class FrequencySketch : public ColumnEstimator<FrequencySketch> {
+private:
+    CountMinSketch sketch;
+    HeavyHitters heavy;
+    int compactCursor = 0;
+    // Whether the sketch was updated since the heavy-hitters walk in progress, or the last one, started.
+    bool changed = false;
+    // Wider sketch being filled from the sample, and the stratum and sample word read next.
+    CountMinSketch next;
+    bool growing = false;
+    int stratum = 0;
+    int cursor = 0;
+
+public:
+    void init(int depth, int width, int heavyHitters, std::mt19937_64 &rng, Arena *arena);
+    void insert(int value, uint32_t weight = 1);
+    void remove(int value, uint32_t weight = 1);
+    /**
+     * Estimate the number of tuples equal to value.
+     * @param value Compared constant.
+     * @param uniform Estimate used for values the sketch cannot tell from collision noise, based on live rows / NDV.
+     * @return return estimated count.
+     */
+    double equal(int value, double uniform) const;
+    /**
+     * Tighten a slice of the heavy-hitters table against the sketch.
+     * @param count Number of entries handled.
+     * @return return true once the whole table was handled.
+     */
+    bool compact(int count);
+    // True if compact would tighten anything: a walk is in progress or the sketch was updated since the last one.
+    bool needsCompact() const { return changed || compactCursor != 0; }
+    bool compacting() const { return compactCursor != 0; }
+    bool empty() const { return sketch.empty(); }
+    int getWidth() const { return sketch.getWidth(); }
+    /**
+     * Narrow the sketch at once; see CountMinSketch::fold.
+     */
+    void shrink(int width, Arena *arena);
+    /**
+     * Start replacing the sketch by a wider one. The wider sketch is filled from the sample in slices by scan, and
+     * updates keep going to the current sketch until finishGrow swaps them; the heavy hitters are kept.
+     * @param width Counters per row of the wider sketch, rounded up to a power of two.
+     * @param rng Source of the hash multipliers.
+     * @param arena Arena holding the counters.
+     */
+    void startGrow(int width, std::mt19937_64 &rng, Arena *arena);
+    /**
+     * Read the next slice of the current stratum into the wider sketch, as CdfModel::scan does for a refit.
+     * @param store Sample store of the stratum returned by getStratum().
+     * @param column Column of the sketch in the store.
+     * @param weight Number of rows one sampled tuple of the stratum stands for.
+     * @param words Number of bitmap words, 64 slots each, read by the slice.
+     * @return return true once the stratum has been read.
+     */
+    bool scan(const SampleStore &store, int column, uint32_t weight, int words);
+    void finishGrow();
+    bool isGrowing() const { return growing; }
+    int getStratum() const { return stratum; }
+    // Snapshot of the sketch and of the heavy hitters; load allocates from the arena and returns false on a malformed snapshot.
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+
+    // ColumnEstimator hooks. The sketch answers points, falling back to the prior for values lost in the collision
+    // noise; maintenance is one compact slice of slice entries.
+    static size_t arenaBytes(const EngineConfig &config);
+    void build(std::vector<int> &values, double scale, const EngineConfig &config, std::mt19937_64 &rng, Arena *arena);
+    void onInsert(int value) { insert(value); }
+    void onDelete(int value) { remove(value); }
+    bool estimate(const ColumnRange &range, double prior, double &rows) const
+    {
+        if (!range.isPoint() || empty())
+            return false;
+        rows = equal((int)range.from, prior);
+        return true;
+    }
+    bool maintain(int slice)
+    {
+        if (!needsCompact())
+            return false;
+        compact(slice);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CARDINALITYESTIMATION_GRIDHISTOGRAM
+#define CARDINALITYESTIMATION_GRIDHISTOGRAM
+//
+// Two-dimensional histogram over a pair of columns, used to correct the independence assumption.
+//
+
+#include <common/Root.h>
+#include <estimator/ColumnRange.h>
+#include <estimator/Arena.h>
+#include <estimator/Snapshot.h>
+
+/**
+ * G x G grid whose cell bounds are the equi-depth quantiles of each column in the bootstrap sample. Cell bounds stay
+ * fixed afterwards and only the counters follow insertions and deletions. Inside a cell values are assumed uniform
+ * and the two columns independent.
+ */
+class GridHistogram {
+private:
+    int first;
+    int second;
+    int cells;
+    // cuts[d] holds cells - 1 ascending inclusive upper bounds of the cells of dimension d.
+    ArenaVector<int> cuts[2];
+    long long lower[2];
+    long long upper[2];
+    ArenaVector<double> counts;
+    // Per-cell covered fraction of each dimension, reused across estimates.
+    mutable ArenaVector<double> fractions[2];
+
+    int cellOf(int dimension, int value) const;
+    void coverage(int dimension, const ColumnRange &range, ArenaVector<double> &fractions) const;
+
+public:
+    GridHistogram();
+    /**
+     * Build the grid from a sample of both columns.
+     * @param first Index of the first column.
+     * @param second Index of the second column.
+     * @param a Sampled values of the first column.
+     * @param b Sampled values of the second column, aligned with a.
+     * @param scale Number of tuples represented by one sampled tuple.
+     * @param cells Number of cells per dimension.
+     * @param arena Arena holding the grid.
+     */
+    void build(int first, int second, const std::vector<int> &a, const std::vector<int> &b, double scale, int cells,
+               Arena *arena);
+    void insert(int a, int b);
+    void remove(int a, int b);
+    /**
+     * Estimate the joint and the marginal counts of two column ranges.
+     * @param a Range of the first column.
+     * @param b Range of the second column.
+     * @param marginalA Receives the count of tuples in range a.
+     * @param marginalB Receives the count of tuples in range b.
+     * @return return the count of tuples in both ranges.
+     */
+    double estimate(const ColumnRange &a, const ColumnRange &b, double &marginalA, double &marginalB) const;
+    // Snapshot of the grid; load allocates from the arena and returns false on a malformed snapshot.
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+    bool empty() const { return counts.empty(); }
+    int getFirst() const { return first; }
+    int getSecond() const { return second; }
+};
+
+#endif
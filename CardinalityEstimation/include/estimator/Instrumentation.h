@@ -0,0 +1,122 @@
+#ifndef CARDINALITYESTIMATION_INSTRUMENTATION
+#define CARDINALITYESTIMATION_INSTRUMENTATION
+//
+// Hot-path timings of the engine, compiled in only with CE_INSTRUMENT.
+//
+
+#include <common/Root.h>
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * An enum stands for an instrumented operation.
+ */
+enum ProbeOp {
+    PROBE_INSERT = 0,
+    PROBE_DELETE = 1,
+    PROBE_QUERY = 2,
+    PROBE_PREPARE = 3,
+    PROBE_READ = 4,
+    PROBE_BATCH = 5,
+    PROBE_STAGED = 6,
+    PROBE_COUNT = 7
+};
+
+/**
+ * A struct for one timed call kept in the ring buffer.
+ */
+typedef struct ProbeSample {
+    // Start of the call, in ticks since the instrumentation was created, and its duration in ticks.
+    uint64_t start;
+    uint32_t ticks;
+    // Tuples returned by a readTuples call, passed to an insert or delete, or applied from the staging area,
+    // predicates of a query, or conjunctions of a query batch.
+    uint32_t detail;
+    uint32_t op;
+} ProbeSample;
+
+/**
+ * Per-operation counters and a fixed ring buffer of the most recent calls. Recording a call only updates counters and
+ * overwrites one ring slot, so it does no allocation and no I/O; everything is formatted when the stats are dumped.
+ * Ticks come from rdtsc where available and from steady_clock otherwise, and are converted to nanoseconds at dump
+ * time against steady_clock.
+ */
+class Instrumentation {
+public:
+    static const int RING_SAMPLES = 1 << 14;
+    // Durations are also counted in power-of-two buckets of ticks, for percentiles over every call and not only the
+    // ones left in the ring.
+    static const int DURATION_BUCKETS = 40;
+
+private:
+    typedef struct OpStats {
+        long long calls;
+        long long details;
+        uint64_t totalTicks;
+        uint64_t maxTicks;
+        long long durations[DURATION_BUCKETS];
+    } OpStats;
+    OpStats stats[PROBE_COUNT];
+    std::vector<ProbeSample> ring;
+    long long recorded;
+    uint64_t originTicks;
+    long long originNs;
+
+public:
+    Instrumentation();
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+    void record(ProbeOp op, uint64_t begin, uint64_t end, uint32_t detail);
+    /**
+     * Format the counters and the ring buffer as one JSON object.
+     */
+    std::string toJson() const;
+    /**
+     * Write toJson() to a file.
+     * @return return false if the file cannot be written.
+     */
+    bool dump(const std::string &path) const;
+};
+
+/**
+ * Times the enclosing scope and records it on destruction. A null instrumentation records nothing.
+ */
+class ProbeScope {
+private:
+    Instrumentation *instrumentation;
+    ProbeOp op;
+    uint32_t detail;
+    uint64_t begin;
+
+public:
+    ProbeScope(Instrumentation *instrumentation, ProbeOp op, uint32_t detail)
+        : instrumentation(instrumentation), op(op), detail(detail), begin(Instrumentation::now())
+    {
+    }
+    ~ProbeScope()
+    {
+        if (instrumentation != nullptr)
+            instrumentation->record(op, begin, Instrumentation::now(), detail);
+    }
+    void setDetail(uint32_t detail) { this->detail = detail; }
+};
+
+// Probes compile to nothing unless CE_INSTRUMENT is defined, so the submission pays no cost for them.
+#ifdef CE_INSTRUMENT
+#define CE_PROBE(instrumentation, op, detail) ProbeScope probeScope(instrumentation, op, detail)
+#define CE_PROBE_DETAIL(detail) probeScope.setDetail(detail)
+#else
+#define CE_PROBE(instrumentation, op, detail) ((void)0)
+#define CE_PROBE_DETAIL(detail) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef CARDINALITYESTIMATION_MAINTENANCESCHEDULER
+#define CARDINALITYESTIMATION_MAINTENANCESCHEDULER
+//
+// Cooperative scheduler of the background maintenance done in CEEngine::prepare().
+//
+
+#include <common/Root.h>
+#include <functional>
+
+/**
+ * Round-robin list of maintenance tasks. A task is a function doing one bounded slice of work and returning whether
+ * there was anything to do. Every run() executes slices until the step or time budget is spent or no task has work
+ * left, and the next run() resumes with the task after the last one served, so no task starves.
+ */
+class MaintenanceScheduler {
+private:
+    typedef struct Task {
+        const char *name;
+        std::function<bool()> step;
+        long long slices;
+    } Task;
+    std::vector<Task> tasks;
+    int cursor;
+    int maxSteps;
+    double budgetUs;
+
+public:
+    MaintenanceScheduler();
+    /**
+     * @param maxSteps Maximum number of slices executed by one run.
+     * @param budgetUs Time after which a run stops starting new slices, in microseconds.
+     */
+    void setBudget(int maxSteps, double budgetUs);
+    /**
+     * Register a task.
+     * @param name Name used in reports.
+     * @param step Function doing one slice of work, returning false when it had nothing to do.
+     */
+    void addTask(const char *name, std::function<bool()> step);
+    /**
+     * Execute slices within the budget.
+     * @return return number of slices that did work.
+     */
+    int run();
+    int taskCount() const { return (int)tasks.size(); }
+    const char *taskName(int task) const { return tasks[task].name; }
+    long long taskSlices(int task) const { return tasks[task].slices; }
+};
+
+#endif
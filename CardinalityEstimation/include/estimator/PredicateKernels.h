@@ -0,0 +1,80 @@
+#ifndef CARDINALITYESTIMATION_PREDICATEKERNELS
+#define CARDINALITYESTIMATION_PREDICATEKERNELS
+//
+// Predicate evaluation over the columnar sample.
+//
+
+#include <common/Root.h>
+#include <common/Expression.h>
+#include <estimator/SampleStore.h>
+
+/**
+ * An enum stands for the instruction set used by the predicate kernels. The best level supported by the CPU is
+ * picked at startup.
+ */
+enum KernelLevel { KERNEL_SCALAR = 0, KERNEL_SSE2 = 1, KERNEL_AVX2 = 2 };
+
+/**
+ * Build the selection bitmask of one predicate over a column, bit i of the mask standing for slot i.
+ * @param values Column array, padded to words * 64 values.
+ * @param words Number of mask words to produce.
+ * @param op Compare operator.
+ * @param value Compare constant.
+ * @param mask Output mask. It is overwritten, or ANDed with the predicate result if combine is true.
+ * @param combine Whether to AND into the existing mask.
+ */
+void selectColumn(const int32_t *values, int words, CompareOp op, int value, uint64_t *mask, bool combine);
+// Same over unsigned codes of 2 or 1 bytes, compared with a code.
+void selectColumn(const uint16_t *codes, int words, CompareOp op, int code, uint64_t *mask, bool combine);
+void selectColumn(const uint8_t *codes, int words, CompareOp op, int code, uint64_t *mask, bool combine);
+
+/**
+ * Same as selectColumn, but only counts the slots that are set in both the result and live instead of storing the
+ * result. Used for the last predicate of a conjunction so it needs no extra pass.
+ * @return return number of selected live slots.
+ */
+int selectColumnCount(const int32_t *values, int words, CompareOp op, int value, const uint64_t *mask,
+                      const uint64_t *live, bool combine);
+int selectColumnCount(const uint16_t *codes, int words, CompareOp op, int code, const uint64_t *mask,
+                      const uint64_t *live, bool combine);
+int selectColumnCount(const uint8_t *codes, int words, CompareOp op, int code, const uint64_t *mask,
+                      const uint64_t *live, bool combine);
+
+/**
+ * Count the live sampled tuples satisfying every predicate of quals, comparing the codes of the store with the
+ * translated constants.
+ * @param store Sample to scan.
+ * @param quals Conjunction of predicates. Column indexes must be valid for the store.
+ * @param mask Scratch buffer, resized as needed and reused across calls.
+ * @return return number of matching live slots.
+ */
+int countMatches(const SampleStore &store, const std::vector<CompareExpression> &quals, std::vector<uint64_t> &mask);
+
+/**
+ * Build the selection mask of one predicate over the whole store, translating its constant into the code space of
+ * the column. Bits of slots that are not live are unspecified.
+ * @param store Sample to scan.
+ * @param expr Predicate. Its column index must be valid for the store.
+ * @param mask Output mask of store.usedWords() words. It is overwritten, or ANDed with the predicate result if
+ *        combine is true.
+ * @param combine Whether to AND into the existing mask.
+ */
+void selectPredicate(const SampleStore &store, const CompareExpression &expr, uint64_t *mask, bool combine);
+
+/**
+ * Count the live slots set in every one of the given masks.
+ * @param masks Masks of words words each.
+ * @param count Number of masks; with none, every live slot counts.
+ * @return return number of live slots selected by every mask.
+ */
+int countMasks(const uint64_t *const *masks, int count, const uint64_t *live, int words);
+
+/**
+ * Force the kernels to an instruction set, e.g. to benchmark the scalar fallback. Levels the CPU does not support
+ * are lowered to the best supported one.
+ * @return return the level actually in use.
+ */
+KernelLevel setKernelLevel(KernelLevel level);
+KernelLevel getKernelLevel();
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef CARDINALITYESTIMATION_RESERVOIR
+#define CARDINALITYESTIMATION_RESERVOIR
+//
+// Uniform reservoir sample of the tuples seen by the engine.
+//
+
+#include <common/Root.h>
+#include <estimator/SampleStore.h>
+#include <estimator/SlotIndex.h>
+
+/**
+ * A fixed-size uniform sample that stays uniform under insertions and deletions. Offers made while bootstrapping use
+ * Algorithm R; once started, the sample is maintained with random pairing (Gemulla et al.), in which an insertion
+ * compensates an earlier deletion with the probability that the deleted tuple was sampled.
+ */
+class Reservoir {
+private:
+    int capacity;
+    long long seen;
+    long long population;
+    // Deletions not yet compensated by an insertion, of sampled and of unsampled tuples.
+    long long sampledDeletes;
+    long long unsampledDeletes;
+    std::mt19937_64 *rng;
+    SampleStore store;
+    SlotIndex slotOf;
+
+    void add(TupleRef tuple, int tupleId);
+    void replace(int slot, TupleRef tuple, int tupleId);
+    void evict(int slot);
+
+public:
+    /**
+     * @param capacity Maximum number of sampled tuples.
+     * @param rng Random generator shared with the owner of the reservoir.
+     */
+    Reservoir(int capacity, std::mt19937_64 *rng);
+    /**
+     * Allocate the sample store. Called once the number of columns is known, before the first tuple is added.
+     * @param columns Number of columns of a tuple.
+     * @param arena Arena holding the sample.
+     * @param plans Coding of every column, or null to keep raw values.
+     */
+    void setColumns(int columns, Arena *arena, const std::vector<ColumnPlan> *plans = nullptr);
+    /**
+     * Offer a tuple to the sample following Algorithm R.
+     * @param tuple Offered tuple.
+     * @param tupleId Location of the tuple, or -1 if it is unknown.
+     */
+    void offer(TupleRef tuple, int tupleId);
+    /**
+     * Shrink the capacity to the current size. Used when the sample was drawn from a part of the data set only, so
+     * that a later insertion cannot be over-represented.
+     */
+    void seal();
+    /**
+     * Switch from bootstrapping to incremental maintenance.
+     * @param population Number of live tuples the current sample represents.
+     */
+    void start(long long population);
+    /**
+     * Account for an inserted tuple in O(1).
+     * @param tuple Inserted tuple.
+     * @param tupleId Location of the inserted tuple.
+     */
+    void insert(TupleRef tuple, int tupleId);
+    /**
+     * Account for a deleted tuple in O(1), evicting it if it is sampled.
+     * @param tupleId Location of the deleted tuple.
+     */
+    void remove(int tupleId);
+    /**
+     * Exchange a uniformly chosen sampled tuple with an unsampled one. When the unsampled tuple is picked uniformly
+     * among the unsampled ones, the exchange keeps the sample uniform while replacing its content over time.
+     * @param tuple Unsampled tuple.
+     * @param tupleId Location of the unsampled tuple.
+     */
+    void swapIn(TupleRef tuple, int tupleId);
+    /**
+     * Lower the capacity by one, evicting a uniformly chosen sampled tuple if the sample is full. The remaining sample
+     * is still uniform, so the capacity can be handed over to another stratum.
+     */
+    void shrink();
+    // Snapshot of the sample and its counters. The slot index is not stored, load rebuilds it from the sample.
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+    bool contains(int tupleId) const { return slotOf.find(tupleId) >= 0; }
+    int size() const { return store.size(); }
+    // True while every live tuple is sampled, in which case the sample answers queries exactly.
+    bool isExact() const { return store.size() == population; }
+    int getCapacity() const { return capacity; }
+    long long getSeen() const { return seen; }
+    long long getPopulation() const { return population; }
+    const SampleStore &getStore() const { return store; }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CARDINALITYESTIMATION_SAMPLEBOOTSTRAP
+#define CARDINALITYESTIMATION_SAMPLEBOOTSTRAP
+//
+// Builds the initial statistics of the engine from a bounded number of readTuples chunks.
+//
+
+#include <common/Root.h>
+#include <executer/DataExecuter.h>
+#include <estimator/EngineConfig.h>
+#include <estimator/ColumnSummary.h>
+#include <estimator/Reservoir.h>
+#include <estimator/TupleBatchReader.h>
+
+/**
+ * A struct for the outcome of a bootstrap run.
+ */
+typedef struct BootstrapResult {
+    long long tuplesRead = 0;
+    int chunksRead = 0;
+    int columns = 0;
+    // True if every tuple of the initial data set was read, so the sample covers the whole table.
+    bool fullScan = false;
+    double elapsedMs = 0;
+} BootstrapResult;
+
+class SampleBootstrap {
+private:
+    const EngineConfig &config;
+    TupleBatchReader &reader;
+    std::mt19937_64 *rng;
+    Arena *arena;
+    // Codings of the sampled columns, or empty to choose them from the first batch read.
+    std::vector<ColumnPlan> plans;
+    // Chunks of the table read, as (start, length) pairs.
+    std::vector<std::pair<int, int>> readRanges;
+
+    std::vector<long long> chooseBlocks(int num, int chunk, long long budget);
+    void readChunk(int start, int len, Reservoir &reservoir, ArenaVector<ColumnSummary> &summaries,
+                   BootstrapResult &result);
+
+public:
+    SampleBootstrap(const EngineConfig &config, TupleBatchReader &reader, std::mt19937_64 *rng);
+    /**
+     * Read chunks of the first num tuples until the tuple or time budget is exhausted. The stream of read tuples is
+     * fed into the reservoir, and the per-column summaries are filled from every tuple read.
+     * @param num Size of the initial data set.
+     * @param reservoir Reservoir receiving the sampled tuples.
+     * @param summaries Per-column summaries, resized to the detected number of columns.
+     * @param arena Arena the sample is allocated from.
+     * @param plans Codings of the sampled columns, one per column, or empty to choose them from the first batch.
+     * @return return statistics about the run.
+     */
+    BootstrapResult run(int num, Reservoir &reservoir, ArenaVector<ColumnSummary> &summaries, Arena *arena,
+                        const std::vector<ColumnPlan> &plans);
+    const std::vector<std::pair<int, int>> &getReadRanges() const { return readRanges; }
+};
+
+#endif
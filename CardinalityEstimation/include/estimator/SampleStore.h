@@ -0,0 +1,163 @@
+#ifndef CARDINALITYESTIMATION_SAMPLESTORE
+#define CARDINALITYESTIMATION_SAMPLESTORE
+//
+// Columnar storage of the sampled tuples.
+//
+
+#include <common/Root.h>
+#include <common/Expression.h>
+#include <cstdint>
+#include <estimator/TupleRef.h>
+#include <estimator/Arena.h>
+#include <estimator/Snapshot.h>
+
+/**
+ * An enum stands for the way the values of a sampled column are coded.
+ * ENCODE_RAW keeps the 32-bit values, ENCODE_FOR stores value - base in 1 or 2 bytes (frame of reference), and
+ * ENCODE_DICT stores the rank of the value in a sorted dictionary of at most 256 values in 1 byte. Every coding keeps
+ * the order of the values, so predicates are evaluated on the codes.
+ */
+enum ColumnEncoding { ENCODE_RAW = 0, ENCODE_FOR = 1, ENCODE_DICT = 2 };
+
+/**
+ * A struct for the coding of a column, chosen before the column is filled.
+ */
+typedef struct ColumnPlan {
+    ColumnEncoding encoding = ENCODE_RAW;
+    // Bytes per code: 1, 2 or 4.
+    int width = 4;
+    // Value of code 0 of a frame-of-reference column.
+    int base = 0;
+    // Sorted distinct values of a dictionary column.
+    std::vector<int32_t> dictionary;
+} ColumnPlan;
+
+/**
+ * An enum stands for the result of translating a predicate constant into the code space of a column.
+ */
+enum CodeMatch { MATCH_NONE = 0, MATCH_ALL = 1, MATCH_COMPARE = 2 };
+
+/**
+ * A struct for a predicate on codes: no live code matches, every live code matches, or the codes compare with code
+ * under op.
+ */
+typedef struct CodePredicate {
+    CodeMatch match;
+    CompareOp op;
+    int code;
+} CodePredicate;
+
+/**
+ * Struct-of-arrays store for a fixed number of sample slots. Every column is one contiguous array of codes, and a
+ * bitmap tells which slots hold a live tuple. Arrays are padded to a multiple of 64 slots so predicate kernels always
+ * work on whole bitmap words. A value the coding of its column cannot represent widens the coding, recoding the
+ * column once.
+ */
+class SampleStore {
+public:
+    static const int DICTIONARY_LIMIT = 256;
+
+private:
+    typedef struct PackedColumn {
+        ColumnEncoding encoding;
+        int width;
+        int base;
+        ArenaVector<int32_t> dictionary;
+        // Codes of padded slots, held in 64-bit words so that every code width is aligned.
+        ArenaVector<uint64_t> codes;
+    } PackedColumn;
+    int columns;
+    int slots;
+    int liveCount;
+    // Number of slots ever used; slots at or above it are neither live nor on the free list.
+    int used;
+    // Every column holds codes for padded slots.
+    int padded;
+    Arena *arena;
+    ArenaVector<PackedColumn> packed;
+    ArenaVector<uint64_t> live;
+    ArenaVector<int> ids;
+    ArenaVector<int> freeSlots;
+
+    void allocate(PackedColumn &column, const ColumnPlan &plan);
+    bool encode(const PackedColumn &column, int value, uint32_t &code) const;
+    void store(PackedColumn &column, int slot, uint32_t code);
+    void widen(int column, int value);
+
+public:
+    SampleStore();
+    /**
+     * Allocate the arrays. Must be called once before the first add.
+     * @param columns Number of columns of a tuple.
+     * @param slots Maximum number of stored tuples.
+     * @param arena Arena holding the arrays.
+     * @param plans Coding of every column, or null to keep raw values.
+     */
+    void init(int columns, int slots, Arena *arena, const std::vector<ColumnPlan> *plans);
+    /**
+     * Choose the narrowest coding of a column from a preview of its values, leaving room for values somewhat beyond
+     * the previewed range.
+     * @param values Previewed values.
+     * @param count Number of previewed values.
+     */
+    static ColumnPlan planColumn(const int32_t *values, int count);
+    // Current coding of every column, e.g. to start another store alike.
+    std::vector<ColumnPlan> plans() const;
+    /**
+     * Store a tuple in a free slot.
+     * @param tuple Values of the tuple.
+     * @param tupleId Location of the tuple.
+     * @return return the slot holding the tuple.
+     */
+    int add(TupleRef tuple, int tupleId);
+    /**
+     * Overwrite the tuple stored in a live slot.
+     */
+    void set(int slot, TupleRef tuple, int tupleId);
+    /**
+     * Clear the live bit of a slot and make it available to the next add.
+     */
+    void erase(int slot);
+    /**
+     * Copy the values of the live slots of a column.
+     * @param column Column index.
+     * @param out Receives the values, replacing its content.
+     */
+    void columnValues(int column, std::vector<int> &out) const;
+    /**
+     * Decode the 64 values behind one bitmap word of a column.
+     * @param column Column index.
+     * @param word Bitmap word.
+     * @param out Receives 64 values.
+     */
+    void decodeWord(int column, int word, int32_t *out) const;
+    /**
+     * Translate a predicate constant into the code space of a column.
+     */
+    CodePredicate translate(int column, CompareOp op, int value) const;
+    /**
+     * Pick a live slot uniformly at random. The store must not be empty.
+     */
+    int randomLiveSlot(std::mt19937_64 &rng) const;
+    // Snapshot of the store; load allocates from the arena and returns false on a malformed snapshot.
+    void save(SnapshotWriter &out) const;
+    bool load(SnapshotReader &in, Arena *arena);
+    bool initialized() const { return columns > 0; }
+    int columnCount() const { return columns; }
+    int size() const { return liveCount; }
+    int getSlots() const { return slots; }
+    // Number of bitmap words that can hold a live bit.
+    int usedWords() const { return (used + 63) >> 6; }
+    bool isLive(int slot) const { return (live[slot >> 6] >> (slot & 63)) & 1; }
+    int tupleId(int slot) const { return ids[slot]; }
+    int value(int column, int slot) const;
+    // Codes of a column, codeWidth(column) bytes each.
+    const void *codes(int column) const { return packed[column].codes.data(); }
+    int codeWidth(int column) const { return packed[column].width; }
+    ColumnEncoding encodingOf(int column) const { return packed[column].encoding; }
+    // Bytes taken by the codes and dictionaries of every column.
+    size_t codeBytes() const;
+    const uint64_t *liveWords() const { return live.data(); }
+};
+
+#endif
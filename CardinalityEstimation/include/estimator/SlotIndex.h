@@ -0,0 +1,61 @@
+#ifndef CARDINALITYESTIMATION_SLOTINDEX
+#define CARDINALITYESTIMATION_SLOTINDEX
+//
+// Map from the tupleId of a sampled tuple to its sample slot.
+//
+
+#include <common/Root.h>
+#include <estimator/Arena.h>
+
+/**
+ * Open-addressing hash map from non-negative tupleIds to slots. Keys are hashed multiplicatively into a power-of-two
+ * table kept at most half full, collisions are resolved by linear probing, and erase shifts the following entries
+ * back instead of leaving tombstones, so probe lengths do not grow with churn. The table is sized once for the whole
+ * sample and never rehashes.
+ */
+class SlotIndex {
+private:
+    typedef struct Entry {
+        int key;
+        int slot;
+    } Entry;
+    static const int EMPTY = -1;
+    ArenaVector<Entry> entries;
+    uint32_t mask;
+    int shift;
+    int count;
+
+    uint32_t home(int key) const { return (uint32_t)((uint32_t)key * 0x9e3779b1u) >> shift; }
+
+public:
+    SlotIndex();
+    /**
+     * Allocate the table.
+     * @param keys Maximum number of keys held at once.
+     * @param arena Arena holding the table.
+     */
+    void init(int keys, Arena *arena);
+    /**
+     * @param key TupleId.
+     * @return return the slot of key, or -1 if it is not in the map.
+     */
+    int find(int key) const
+    {
+        if (count == 0)
+            return -1;
+        for (uint32_t i = home(key);; i = (i + 1) & mask) {
+            if (entries[i].key == key)
+                return entries[i].slot;
+            if (entries[i].key == EMPTY)
+                return -1;
+        }
+    }
+    // Insert key or update its slot.
+    void set(int key, int slot);
+    void erase(int key);
+    int size() const { return count; }
+    // Size of the table for the given number of keys, in bytes.
+    static size_t tableBytes(int keys);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef CARDINALITYESTIMATION_SNAPSHOT
+#define CARDINALITYESTIMATION_SNAPSHOT
+//
+// Binary snapshot of the engine statistics.
+//
+
+#include <common/Root.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/**
+ * Serializer of a snapshot. Values are appended in host byte order and every value, array or string is padded to
+ * 8 bytes; arrays are stored as their length followed by their raw elements, so that a mapped snapshot can be read in
+ * place.
+ */
+class SnapshotWriter {
+private:
+    std::vector<char> buffer;
+
+    void pad() { buffer.resize((buffer.size() + 7) & ~(size_t)7, 0); }
+
+public:
+    template <typename T>
+    void put(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are stored");
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        pad();
+    }
+    template <typename T, typename Allocator>
+    void putVector(const std::vector<T, Allocator> &values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are stored");
+        put<uint64_t>(values.size());
+        const char *bytes = reinterpret_cast<const char *>(values.data());
+        buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+        pad();
+    }
+    void putString(const std::string &value)
+    {
+        put<uint64_t>(value.size());
+        buffer.insert(buffer.end(), value.begin(), value.end());
+        pad();
+    }
+    /**
+     * Write the snapshot behind a versioned header carrying its size and checksum.
+     * @param path Snapshot file. It is written to a temporary file first and renamed, so a crash never leaves a
+     * truncated snapshot behind.
+     * @return return false if the file cannot be written.
+     */
+    bool writeFile(const std::string &path) const;
+};
+
+/**
+ * Reader of a snapshot mapped in memory. A read past the end or of an implausible length fails the reader, and every
+ * later read fails too, so callers check ok() once at the end.
+ */
+class SnapshotReader {
+private:
+    const char *base;
+    size_t length;
+    const char *cursor;
+    const char *end;
+    bool valid;
+
+    void skip(uint64_t bytes) { cursor += std::min((uint64_t)(end - cursor), (bytes + 7) & ~(uint64_t)7); }
+
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+    /**
+     * Map a snapshot file and check its header and checksum.
+     * @return return false if it is missing, of another version, or corrupted.
+     */
+    bool open(const std::string &path);
+    bool ok() const { return valid; }
+    template <typename T>
+    bool get(T &value)
+    {
+        if (!valid || (size_t)(end - cursor) < sizeof(T))
+            return valid = false;
+        memcpy(&value, cursor, sizeof(T));
+        skip(sizeof(T));
+        return true;
+    }
+    template <typename T, typename Allocator>
+    bool getVector(std::vector<T, Allocator> &values)
+    {
+        uint64_t size = 0;
+        if (!get(size) || size > (uint64_t)(end - cursor) / sizeof(T))
+            return valid = false;
+        const T *first = reinterpret_cast<const T *>(cursor);
+        values.assign(first, first + size);
+        skip(size * sizeof(T));
+        return true;
+    }
+    bool getString(std::string &value)
+    {
+        uint64_t size = 0;
+        if (!get(size) || size > (uint64_t)(end - cursor))
+            return valid = false;
+        value.assign(cursor, (size_t)size);
+        skip(size);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CARDINALITYESTIMATION_TUPLEBATCHREADER
+#define CARDINALITYESTIMATION_TUPLEBATCHREADER
+//
+// Batched reader on top of DataExecuter::readTuples.
+//
+
+#include <common/Root.h>
+#include <cstdint>
+#include <executer/DataExecuter.h>
+#include <estimator/TupleRef.h>
+#include <estimator/Instrumentation.h>
+
+/**
+ * Reads tuples into one reused batch buffer and flattens them right away into a column-major arena, so consumers scan
+ * contiguous columns. The batch size is capped so that the transient per-tuple vectors and the arena together fit in
+ * the L2 cache. The outer buffer and the arena are allocated once; the per-tuple vectors themselves are created by
+ * readTuples and cannot be avoided through its interface.
+ */
+class TupleBatchReader {
+private:
+    DataExecuter *dataExecuter;
+    std::vector<std::vector<int>> batch;
+    std::vector<int32_t> arena;
+    int cacheBytes;
+    int limit;
+    int columns;
+    int rows;
+    long long tuplesRead;
+    long long calls;
+    Instrumentation *instrumentation;
+
+public:
+    /**
+     * @param dataExecuter Interfaces for datasets.
+     * @param cacheBytes Size of the cache the batch should fit in.
+     */
+    TupleBatchReader(DataExecuter *dataExecuter, int cacheBytes);
+    /**
+     * Read the tuples at [start, start + count). count must not exceed batchLimit().
+     * @return return number of tuples read, i.e. not deleted.
+     */
+    int read(int start, int count);
+    // Largest count accepted by read.
+    int batchLimit() const { return limit; }
+    // Instrumentation every readTuples call is recorded to when built with CE_INSTRUMENT, or null.
+    void setInstrumentation(Instrumentation *instrumentation) { this->instrumentation = instrumentation; }
+    int size() const { return rows; }
+    int columnCount() const { return columns; }
+    const int32_t *column(int column) const { return arena.data() + (long long)column * limit; }
+    TupleRef tuple(int row) const { return TupleRef(arena.data() + row, limit); }
+    long long getTuplesRead() const { return tuplesRead; }
+    long long getCalls() const { return calls; }
+    // Heap memory held by the batch buffer and its flattened copy, in bytes.
+    size_t bufferBytes() const;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CARDINALITYESTIMATION_TUPLEREF
+#define CARDINALITYESTIMATION_TUPLEREF
+//
+// Non-owning view of one tuple.
+//
+
+#include <common/Root.h>
+
+/**
+ * A struct for a tuple stored anywhere: value c is at values[c * stride]. A row-major tuple has stride 1, a row of a
+ * column-major arena has the arena row capacity as stride.
+ */
+typedef struct TupleRef {
+    const int *values;
+    long long stride;
+
+    TupleRef(const int *values, long long stride) : values(values), stride(stride) {}
+    TupleRef(const std::vector<int> &tuple) : values(tuple.data()), stride(1) {}
+    int operator[](int column) const { return values[column * stride]; }
+} TupleRef;
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef CARDINALITYESTIMATION_BINARYTRACE
+#define CARDINALITYESTIMATION_BINARYTRACE
+//
+// Binary trace of a workload: a snapshot of the initial tuples followed by the action stream.
+//
+
+#include <common/Root.h>
+#include <common/Expression.h>
+#include <executer/DataExecuter.h>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * A struct for the header of a binary trace file. The file is made of the header, the initial tuples as row-major
+ * int32 values, then the action records. A record starts with a TraceRecord and is followed by int32 payload: the
+ * tuple values for INSERT and DELETE, and for QUERY the predicates as (column, operator, value) triples followed by
+ * the exact answer as two int32 halves, low half first. Everything is 4-byte aligned and in host byte order.
+ */
+typedef struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t tuples;
+    uint64_t actions;
+    uint64_t actionBytes;
+} TraceHeader;
+
+typedef struct TraceRecord {
+    // ActionType of the demo: 1 INSERT, 2 DELETE, 3 QUERY.
+    uint8_t type;
+    uint8_t predicates;
+    uint16_t reserved;
+    int32_t tupleId;
+} TraceRecord;
+
+/**
+ * A struct for one replayed action. The pointers refer to the mapped file and stay valid while it is open.
+ */
+typedef struct TraceAction {
+    int type;
+    int tupleId;
+    // Tuple values of an INSERT or DELETE, columns values.
+    const int32_t *tuple;
+    // Predicates of a QUERY.
+    const CompareExpression *quals;
+    int predicates;
+    long long answer;
+} TraceAction;
+
+/**
+ * Writer of a binary trace. The header is completed when the writer is closed.
+ */
+class TraceWriter {
+private:
+    FILE *file;
+    TraceHeader header;
+
+    void write(const void *data, size_t bytes);
+
+public:
+    TraceWriter();
+    ~TraceWriter();
+    /**
+     * Create the file and write the initial tuples.
+     * @param path Trace file.
+     * @param columns Number of columns of a tuple.
+     * @param tuples Number of initial tuples.
+     * @param rows Initial tuples, row-major.
+     * @return return false if the file cannot be written.
+     */
+    bool open(const std::string &path, int columns, int tuples, const int32_t *rows);
+    void insert(const int32_t *tuple);
+    void remove(int tupleId, const int32_t *tuple);
+    // A query of more than 255 predicates fails the trace, as a write error does.
+    void query(const std::vector<CompareExpression> &quals, long long answer);
+    // Complete the header and close the file. Returns false if some write failed.
+    bool close();
+};
+
+/**
+ * Data executer replaying a binary trace from a memory-mapped file. readTuples serves the initial tuples straight from
+ * the mapping and inserted tuples from their action records, skipping deleted tuples with a bitmap.
+ */
+class MappedTraceExecuter : public DataExecuter {
+private:
+    const char *base;
+    size_t length;
+    TraceHeader header;
+    const int32_t *initial;
+    const char *cursor;
+    const char *stop;
+    uint64_t replayed;
+    // Values of the tuples inserted by the replayed actions, in tupleId order after the initial tuples.
+    std::vector<const int32_t *> inserted;
+    std::vector<uint64_t> deleted;
+    long long tuplesRead;
+
+    const int32_t *row(long long tupleId) const
+    {
+        return tupleId < (long long)header.tuples ? initial + tupleId * header.columns
+                                                   : inserted[tupleId - header.tuples];
+    }
+
+public:
+    MappedTraceExecuter();
+    ~MappedTraceExecuter();
+    /**
+     * Map a trace file.
+     * @return return false if the file cannot be mapped or is not a valid trace.
+     */
+    bool open(const std::string &path);
+    /**
+     * Replay the next action without copying it.
+     * @return return false at the end of the trace, or if the next record is malformed.
+     */
+    bool next(TraceAction &action);
+    void readTuples(int tupleId, int offset, std::vector<std::vector<int>> &vec);
+    // q-error of an estimate of the last replayed query, as DataExecuterDemo::answer computes it.
+    static double answer(int ans, const TraceAction &action);
+    int getColumns() const { return (int)header.columns; }
+    long long getInitialTuples() const { return (long long)header.tuples; }
+    long long getActions() const { return (long long)header.actions; }
+    long long getTuplesRead() const { return tuplesRead; }
+};
+
+#endif
@@ -1,43 +1,129 @@
-#ifndef CARDINALITYESTIMATION_DATAEXECUTERDEMO
-#define CARDINALITYESTIMATION_DATAEXECUTERDEMO
-//
-// Demo data generator for local debugging. You can implement your own data generator for debugging based on this class.
-//
-
-#include <common/Root.h>
-#include <common/Expression.h>
-#include <executer/DataExecuter.h>
-
-/**
- * An enum stands for the action operator.
- */
-enum ActionType { NONE = 0, INSERT = 1, DELETE = 2, QUERY = 3 };
-
-/**
- * A class for the action.
- */
-typedef struct Action {
-    ActionType actionType;
-    std::vector<int> actionTuple;
-    int tupleId;
-    std::vector<CompareExpression> quals;
-} Action;
-
-// Demo data generator for local debugging.
-class DataExecuterDemo : public DataExecuter {
-private:
-    int end;
-    int count;
-    Action curAction;
-    std::vector<std::vector<int>> set;
-    std::vector<int> generateInsert();
-    int generateDelete();
-
-public:
-    DataExecuterDemo(int end, int count);
-    Action getNextAction();
-    void readTuples(int tupleId, int offset, std::vector<std::vector<int>> &vec);
-    double answer(int ans);
-};
-
+#ifndef CARDINALITYESTIMATION_DATAEXECUTERDEMO
+#define CARDINALITYESTIMATION_DATAEXECUTERDEMO
+//
+// Demo data generator for local debugging. You can implement your own data generator for debugging based on this class.
+//
+
+#include <common/Root.h>
+#include <common/Expression.h>
+#include <executer/DataExecuter.h>
+#include <executer/DemoOracle.h>
+#include <executer/ValueGenerator.h>
+#include <fstream>
+
+/**
+ * An enum stands for the action operator.
+ */
+enum ActionType { NONE = 0, INSERT = 1, DELETE = 2, QUERY = 3 };
+
+/**
+ * A class for the action.
+ */
+typedef struct Action {
+    ActionType actionType;
+    std::vector<int> actionTuple;
+    int tupleId;
+    std::vector<CompareExpression> quals;
+} Action;
+
+/**
+ * A struct for the workload of the demo generator. The defaults reproduce the original demo: two uniform columns,
+ * and out of every 100 actions 90 inserts, 9 deletes and one single-predicate query.
+ */
+typedef struct DemoConfig {
+    // Seed of the random source of the generator; the same configuration and seed give the same workload.
+    unsigned seed = 1;
+    int columns = 2;
+    // Actions per 100 that are inserts and deletes, the rest are queries.
+    int insertPercent = 90;
+    int deletePercent = 9;
+    // Number of predicates of a query, drawn uniformly in [minPredicates, maxPredicates].
+    int minPredicates = 1;
+    int maxPredicates = 1;
+    // Operators drawn for the predicates.
+    bool equalPredicates = true;
+    bool greaterPredicates = true;
+    // Values are drawn in [0, domain), or in [0, RAND_MAX] if domain is 0.
+    int domain = 0;
+    // Distribution of column c, uniform for the columns past the end.
+    std::vector<ColumnSpec> specs;
+} DemoConfig;
+
+/**
+ * Demo data generator for local debugging. Actions are either generated from a DemoConfig or replayed from a trace
+ * file. A trace is a text file made of a header line "trace <columns> <initial tuples> <actions>", one line of values
+ * per initial tuple, then one line per action: "I <values>", "D <tupleId>" or "Q <predicates> (<column> <op> <value>)*"
+ * with op 0 for EQUAL and 1 for GREATER.
+ */
+class DataExecuterDemo : public DataExecuter {
+private:
+    int end;
+    int count;
+    DemoConfig config;
+    DemoRandom random;
+    long long tuplesRead;
+    // Predicates of the last generated query, kept to answer it.
+    std::vector<CompareExpression> lastQuals;
+    std::vector<std::unique_ptr<ValueGenerator>> generators;
+    std::ifstream replay;
+    std::ofstream recording;
+    bool valid;
+    // Tuples stored row-major, tuple i at data[i * columns, (i + 1) * columns), and one bit per deleted tuple.
+    std::vector<int> data;
+    std::vector<uint64_t> deleted;
+    // Exact per-column value counts used to answer queries.
+    std::vector<ColumnOracle> oracles;
+    void initStorage(int tuples, long long minValue, long long maxValue);
+    void appendTuple(const int *tuple);
+    void removeTuple(int tupleId);
+    void generateInsert(std::vector<int> &tuple);
+    int generateDelete();
+    void generateTuple(long long index, int *tuple);
+    CompareExpression generatePredicate();
+    bool replayAction(Action &action);
+    void recordAction(const Action &action);
+    long long countMatches(const std::vector<CompareExpression> &quals) const;
+    const int *row(int tupleId) const { return data.data() + (size_t)tupleId * config.columns; }
+    bool isDeleted(int tupleId) const { return (deleted[tupleId >> 6] >> (tupleId & 63)) & 1; }
+    // Bits of the live tuples among tuples [64 * word, 64 * word + 64).
+    uint64_t liveWord(int word) const;
+
+public:
+    DataExecuterDemo(int end, int count);
+    DataExecuterDemo(int end, int count, const DemoConfig &config);
+    /**
+     * Replay a recorded trace.
+     * @param tracePath Trace file.
+     */
+    DataExecuterDemo(const std::string &tracePath);
+    /**
+     * Write the initial tuples and every following action to a trace file. Must be called before the first
+     * getNextAction.
+     * @param tracePath Trace file.
+     * @return return false if the file cannot be written.
+     */
+    bool startRecording(const std::string &tracePath);
+    // False if a replayed trace could not be read.
+    bool isValid() const { return valid; }
+    // Number of columns, generated or read from the replayed trace.
+    int getColumns() const { return config.columns; }
+    // Number of tuples stored so far, including deleted ones, and their row-major values.
+    int getTupleCount() const { return end + 1; }
+    const int *getRows() const { return data.data(); }
+    // Exact answer of the last generated query.
+    long long getExactAnswer() const { return countMatches(lastQuals); }
+    Action getNextAction();
+    /**
+     * Same as getNextAction, filling an action owned by the caller. Its tuple and predicate buffers are reused, so
+     * replaying actions into one Action allocates nothing once the buffers have grown.
+     * @param action Receives the next action, NONE once the workload is over.
+     * @return return false once the workload is over.
+     */
+    bool getNextAction(Action &action);
+    void readTuples(int tupleId, int offset, std::vector<std::vector<int>> &vec);
+    double answer(int ans);
+    // Number of tuples returned by readTuples so far.
+    long long getTuplesRead() const { return tuplesRead; }
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef CARDINALITYESTIMATION_DEMOORACLE
+#define CARDINALITYESTIMATION_DEMOORACLE
+//
+// Exact per-column counts used by the demo generator to answer queries.
+//
+
+#include <common/Root.h>
+
+/**
+ * Exact multiset of the live values of one column. The value domain is cut into at most MAX_BUCKETS buckets of equal
+ * width; a Fenwick tree over the bucket counts gives the number of values above a bucket in O(log buckets), and every
+ * bucket keeps its values sorted so the partial bucket is resolved by binary search. With a bucket width of 1 the
+ * sorted values are not needed and are not kept.
+ */
+class ColumnOracle {
+public:
+    static const int MAX_BUCKETS = 1 << 16;
+
+private:
+    long long minValue;
+    long long maxValue;
+    long long width;
+    int buckets;
+    long long total;
+    std::vector<long long> counts;
+    std::vector<long long> tree;
+    std::vector<std::vector<int>> values;
+
+    int bucketOf(long long value) const { return (int)((value - minValue) / width); }
+    // Number of values in buckets [0, bucket).
+    long long prefix(int bucket) const;
+    void add(int bucket, long long delta);
+
+public:
+    ColumnOracle();
+    /**
+     * Reset the oracle to an empty multiset over [minValue, maxValue].
+     */
+    void init(long long minValue, long long maxValue);
+    /**
+     * Add a value before build() is called. Values are only appended, which makes the initial load linear.
+     */
+    void load(int value);
+    // Sort the loaded values and build the bucket tree.
+    void build();
+    void insert(int value);
+    void remove(int value);
+    /**
+     * @param from Lower bound, inclusive.
+     * @param to Upper bound, inclusive.
+     * @return return number of live values in [from, to].
+     */
+    long long range(long long from, long long to) const;
+    long long equal(int value) const { return range(value, value); }
+    long long greater(int value) const { return range((long long)value + 1, maxValue); }
+    long long size() const { return total; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef CARDINALITYESTIMATION_VALUEGENERATOR
+#define CARDINALITYESTIMATION_VALUEGENERATOR
+//
+// Column value distributions of the demo generator.
+//
+
+#include <common/Root.h>
+#include <memory>
+#include <random>
+
+/**
+ * An enum stands for the distribution of the values of a generated column.
+ * DIST_UNIFORM draws uniformly in the domain, DIST_ZIPF draws ranks with P(k) ~ 1 / k^skew and spreads them over the
+ * domain, DIST_NORMAL clusters values around the middle of the domain, DIST_CLUSTERED mixes a few narrow normal
+ * clusters at random centers, and DIST_SORTED grows with the position of the tuple, like a timestamp.
+ */
+enum Distribution { DIST_UNIFORM = 0, DIST_ZIPF = 1, DIST_NORMAL = 2, DIST_CLUSTERED = 3, DIST_SORTED = 4 };
+
+/**
+ * A struct for the description of one generated column.
+ */
+typedef struct ColumnSpec {
+    Distribution distribution = DIST_UNIFORM;
+    // Zipf exponent.
+    double skew = 1.1;
+    // Number of Zipf ranks, capped by the domain size.
+    int distinct = 1 << 16;
+    // Standard deviation of a normal column, of every cluster, and jitter of a sorted column, as a fraction of the
+    // domain.
+    double spread = 0.05;
+    int clusters = 8;
+    // If source is an earlier column, the value copies the source value with probability correlation, plus a jitter
+    // of spread / 10 of the domain; otherwise it is drawn from the distribution above.
+    int source = -1;
+    double correlation = 0.9;
+} ColumnSpec;
+
+/**
+ * Random source of the demo generator. Every DataExecuterDemo draws from its own seeded source instead of the global
+ * rand(), so a workload only depends on its seed, whatever else the process draws.
+ */
+class DemoRandom {
+private:
+    std::mt19937 engine;
+
+public:
+    explicit DemoRandom(unsigned seed) : engine(seed) {}
+    // Uniform integer in [0, RAND_MAX], the range of rand().
+    int next() { return (int)(engine() & RAND_MAX); }
+    // Uniform in (0, 1).
+    double uniform01() { return (next() + 0.5) / ((double)RAND_MAX + 1); }
+    // Standard normal, by Box-Muller on two uniform draws.
+    double gaussian();
+};
+
+/**
+ * Generator of the values of one column. Every random decision is taken from the DemoRandom given to makeGenerator.
+ */
+class ValueGenerator {
+public:
+    virtual ~ValueGenerator() {}
+    /**
+     * @param index Position of the tuple the value is generated for.
+     * @param tuple Values of the earlier columns of the tuple, or nullptr if the value is not part of a tuple, e.g.
+     * a query constant.
+     * @return return a value in [0, maxValue].
+     */
+    virtual int next(long long index, const int *tuple) = 0;
+};
+
+/**
+ * Create the generator of a column.
+ * @param spec Distribution of the column.
+ * @param maxValue Largest generated value; values are drawn in [0, maxValue].
+ * @param rows Expected number of generated tuples, over which a sorted column spans its domain.
+ * @param random Random source, which must outlive the generator.
+ * @return return the generator.
+ */
+std::unique_ptr<ValueGenerator> makeGenerator(const ColumnSpec &spec, int maxValue, long long rows,
+                                              DemoRandom *random);
+
+/**
+ * Parse a distribution name: uniform, zipf, normal, clustered or sorted.
+ * @return return false if the name is unknown.
+ */
+bool parseDistribution(const char *name, Distribution &distribution);
+
+#endif
@@ -0,0 +1,159 @@
+//
+// Memory arena holding all statistics of the engine.
+//
+
+#include <estimator/Arena.h>
+
+SlotPool::SlotPool()
+{
+    clear();
+}
+
+int SlotPool::sizeClass(size_t bytes)
+{
+    int sizeClass = (int)((bytes + SLOT_ALIGN - 1) / SLOT_ALIGN) - 1;
+    return sizeClass < SIZE_CLASSES ? std::max(sizeClass, 0) : -1;
+}
+
+void *SlotPool::pop(int sizeClass)
+{
+    void *slot = freeLists[sizeClass];
+    if (slot != nullptr)
+        freeLists[sizeClass] = *static_cast<void **>(slot);
+    return slot;
+}
+
+void SlotPool::push(int sizeClass, void *slot)
+{
+    *static_cast<void **>(slot) = freeLists[sizeClass];
+    freeLists[sizeClass] = slot;
+}
+
+void SlotPool::clear()
+{
+    for (int i = 0; i < SIZE_CLASSES; ++i)
+        freeLists[i] = nullptr;
+}
+
+Arena::Arena()
+{
+    this->base = nullptr;
+    this->capacity = 0;
+    this->used = 0;
+    this->overflowBytes = 0;
+    this->freeBytes = 0;
+}
+
+Arena::~Arena()
+{
+    for (int i = 0; i < (int)overflow.size(); ++i)
+        std::free(overflow[i]);
+    std::free(base);
+}
+
+void Arena::reserve(size_t bytes)
+{
+    std::free(base);
+    base = static_cast<char *>(std::malloc(bytes));
+    capacity = base == nullptr ? 0 : bytes;
+    used = 0;
+    freeBytes = 0;
+    freeRanges.clear();
+    pool.clear();
+}
+
+void *Arena::reuse(size_t bytes, size_t align)
+{
+    int best = -1;
+    size_t bestSlack = 0;
+    for (int i = 0; i < (int)freeRanges.size(); ++i) {
+        const FreeRange &range = freeRanges[i];
+        size_t skip = (align - (uintptr_t)range.begin % align) % align;
+        if (range.bytes < skip + bytes)
+            continue;
+        size_t slack = range.bytes - skip - bytes;
+        if (best < 0 || slack < bestSlack) {
+            best = i;
+            bestSlack = slack;
+        }
+    }
+    if (best < 0)
+        return nullptr;
+    FreeRange range = freeRanges[best];
+    char *p = range.begin + (align - (uintptr_t)range.begin % align) % align;
+    freeBytes -= range.bytes;
+    // The rest of the range stays available if it is worth tracking; the alignment gap in front is given up.
+    if (bestSlack >= MIN_FREE_BYTES) {
+        freeRanges[best] = {p + bytes, bestSlack};
+        freeBytes += bestSlack;
+    } else {
+        freeRanges[best] = freeRanges.back();
+        freeRanges.pop_back();
+    }
+    return p;
+}
+
+bool Arena::fits(size_t bytes) const
+{
+    // Alignment takes at most a few bytes in front of the allocation.
+    size_t needed = bytes + alignof(std::max_align_t);
+    if (capacity - used >= needed)
+        return true;
+    for (int i = 0; i < (int)freeRanges.size(); ++i) {
+        if (freeRanges[i].bytes >= needed)
+            return true;
+    }
+    return false;
+}
+
+void *Arena::allocate(size_t bytes, size_t align)
+{
+    if (bytes >= MIN_FREE_BYTES && !freeRanges.empty()) {
+        void *p = reuse(bytes, align);
+        if (p != nullptr)
+            return p;
+    }
+    size_t offset = (used + align - 1) & ~(align - 1);
+    if (offset + bytes <= capacity) {
+        used = offset + bytes;
+        return base + offset;
+    }
+    // Overflow blocks are plain heap blocks owned by the arena; malloc alignment covers every statistic type.
+    char *block = static_cast<char *>(std::malloc(std::max<size_t>(bytes, 1)));
+    if (block == nullptr)
+        throw std::bad_alloc();
+    overflow.push_back(block);
+    overflowBytes += bytes;
+    return block;
+}
+
+void Arena::release(void *pointer, size_t bytes)
+{
+    char *p = static_cast<char *>(pointer);
+    if (p >= base && p + bytes == base + used) {
+        used = p - base;
+    } else if (p != nullptr && bytes >= MIN_FREE_BYTES) {
+        freeRanges.push_back({p, bytes});
+        freeBytes += bytes;
+    }
+}
+
+void *Arena::allocateSlot(size_t bytes)
+{
+    int sizeClass = SlotPool::sizeClass(bytes);
+    if (sizeClass < 0)
+        return allocate(bytes, SlotPool::SLOT_ALIGN);
+    void *slot = pool.pop(sizeClass);
+    if (slot == nullptr)
+        slot = allocate((size_t)(sizeClass + 1) * SlotPool::SLOT_ALIGN, SlotPool::SLOT_ALIGN);
+    return slot;
+}
+
+void Arena::releaseSlot(void *pointer, size_t bytes)
+{
+    int sizeClass = SlotPool::sizeClass(bytes);
+    if (sizeClass < 0)
+        release(pointer, bytes);
+    else
+        pool.push(sizeClass, pointer);
+}
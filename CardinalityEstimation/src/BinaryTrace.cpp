@@ -0,0 +1,194 @@
+//
+// Binary trace of a workload: a snapshot of the initial tuples followed by the action stream.
+//
+
+#include <executer/BinaryTrace.h>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char TRACE_MAGIC[8] = {'C', 'E', 'T', 'R', 'A', 'C', 'E', '1'};
+static const uint32_t TRACE_VERSION = 1;
+static_assert(sizeof(CompareExpression) == 3 * sizeof(int32_t), "predicates are mapped as CompareExpression");
+static_assert(sizeof(TraceRecord) == 8, "records are 4-byte aligned");
+
+TraceWriter::TraceWriter()
+{
+    this->file = nullptr;
+    memset(&header, 0, sizeof(header));
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+void TraceWriter::write(const void *data, size_t bytes)
+{
+    if (file != nullptr && fwrite(data, 1, bytes, file) != bytes) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool TraceWriter::open(const std::string &path, int columns, int tuples, const int32_t *rows)
+{
+    close();
+    file = fopen(path.c_str(), "wb");
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.columns = (uint32_t)columns;
+    header.tuples = (uint64_t)tuples;
+    write(&header, sizeof(header));
+    write(rows, sizeof(int32_t) * columns * (size_t)tuples);
+    return file != nullptr;
+}
+
+void TraceWriter::insert(const int32_t *tuple)
+{
+    TraceRecord record = {1, 0, 0, -1};
+    write(&record, sizeof(record));
+    write(tuple, sizeof(int32_t) * header.columns);
+    header.actions++;
+    header.actionBytes += sizeof(record) + sizeof(int32_t) * header.columns;
+}
+
+void TraceWriter::remove(int tupleId, const int32_t *tuple)
+{
+    TraceRecord record = {2, 0, 0, tupleId};
+    write(&record, sizeof(record));
+    write(tuple, sizeof(int32_t) * header.columns);
+    header.actions++;
+    header.actionBytes += sizeof(record) + sizeof(int32_t) * header.columns;
+}
+
+void TraceWriter::query(const std::vector<CompareExpression> &quals, long long answer)
+{
+    // A record counts its predicates in one byte. A wider query cannot be stored with its answer, so it fails the trace.
+    if (quals.size() > UINT8_MAX) {
+        if (file != nullptr)
+            fclose(file);
+        file = nullptr;
+        return;
+    }
+    uint8_t predicates = (uint8_t)quals.size();
+    TraceRecord record = {3, predicates, 0, -1};
+    int32_t halves[2] = {(int32_t)(uint32_t)(uint64_t)answer, (int32_t)(uint32_t)((uint64_t)answer >> 32)};
+    write(&record, sizeof(record));
+    write(quals.data(), sizeof(CompareExpression) * predicates);
+    write(halves, sizeof(halves));
+    header.actions++;
+    header.actionBytes += sizeof(record) + sizeof(CompareExpression) * predicates + sizeof(halves);
+}
+
+bool TraceWriter::close()
+{
+    if (file == nullptr)
+        return false;
+    bool ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+MappedTraceExecuter::MappedTraceExecuter() : DataExecuter()
+{
+    this->base = nullptr;
+    this->length = 0;
+    memset(&header, 0, sizeof(header));
+    this->initial = nullptr;
+    this->cursor = nullptr;
+    this->stop = nullptr;
+    this->replayed = 0;
+    this->tuplesRead = 0;
+}
+
+MappedTraceExecuter::~MappedTraceExecuter()
+{
+    if (base != nullptr)
+        munmap((void *)base, length);
+}
+
+bool MappedTraceExecuter::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(TraceHeader))
+        mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    base = static_cast<const char *>(mapping);
+    length = (size_t)info.st_size;
+    memcpy(&header, base, sizeof(header));
+    size_t initialBytes = (size_t)header.tuples * header.columns * sizeof(int32_t);
+    if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION ||
+        header.columns == 0 || sizeof(header) + initialBytes + header.actionBytes > length)
+        return false;
+    initial = reinterpret_cast<const int32_t *>(base + sizeof(header));
+    cursor = base + sizeof(header) + initialBytes;
+    stop = cursor + header.actionBytes;
+    deleted.assign(header.tuples / 64 + 1, 0);
+    return true;
+}
+
+bool MappedTraceExecuter::next(TraceAction &action)
+{
+    if (replayed >= header.actions || cursor + sizeof(TraceRecord) > stop)
+        return false;
+    const TraceRecord *record = reinterpret_cast<const TraceRecord *>(cursor);
+    const int32_t *payload = reinterpret_cast<const int32_t *>(cursor + sizeof(TraceRecord));
+    size_t words = record->type == 3 ? 3 * (size_t)record->predicates + 2 : header.columns;
+    if (record->type < 1 || record->type > 3 || (const char *)(payload + words) > stop)
+        return false;
+    action.type = record->type;
+    action.tupleId = record->tupleId;
+    action.tuple = payload;
+    action.quals = nullptr;
+    action.predicates = 0;
+    action.answer = 0;
+    long long tuples = (long long)header.tuples + (long long)inserted.size();
+    if (record->type == 1) {
+        action.tupleId = (int)tuples;
+        inserted.push_back(payload);
+        if (deleted.size() * 64 <= (size_t)tuples)
+            deleted.push_back(0);
+    } else if (record->type == 2) {
+        if (record->tupleId < 0 || record->tupleId >= tuples)
+            return false;
+        deleted[record->tupleId >> 6] |= 1ULL << (record->tupleId & 63);
+    } else {
+        action.tuple = nullptr;
+        action.quals = reinterpret_cast<const CompareExpression *>(payload);
+        action.predicates = record->predicates;
+        const uint32_t *halves = reinterpret_cast<const uint32_t *>(payload + 3 * record->predicates);
+        action.answer = (long long)((uint64_t)halves[0] | ((uint64_t)halves[1] << 32));
+    }
+    cursor = (const char *)(payload + words);
+    replayed++;
+    return true;
+}
+
+void MappedTraceExecuter::readTuples(int start, int offset, std::vector<std::vector<int>> &vec)
+{
+    long long from = std::max(start, 0);
+    long long to = std::min((long long)start + offset, (long long)header.tuples + (long long)inserted.size());
+    for (long long i = from; i < to; ++i) {
+        if ((deleted[i >> 6] >> (i & 63)) & 1)
+            continue;
+        const int32_t *tuple = row(i);
+        vec.emplace_back(tuple, tuple + header.columns);
+        tuplesRead++;
+    }
+}
+
+double MappedTraceExecuter::answer(int ans, const TraceAction &action)
+{
+    return fabs(std::log((ans + 1) * 1.0 / (action.answer + 1)));
+}
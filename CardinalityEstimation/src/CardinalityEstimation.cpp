@@ -1,32 +1,1323 @@
-//
-// You should modify this file.
-//
-#include <common/Root.h>
-#include <CardinalityEstimation.h>
-
-void CEEngine::insertTuple(const std::vector<int>& tuple)
-{
-    // Implement your insert tuple logic here.
-}
-
-void CEEngine::deleteTuple(const std::vector<int>& tuple, int tupleId)
-{
-    // Implement your delete tuple logic here.
-}
-
-int CEEngine::query(const std::vector<CompareExpression>& quals)
-{
-    // Implement your query logic here.
-    return 0;
-}
-
-void CEEngine::prepare()
-{
-    // Implement your prepare logic here.
-}
-
-CEEngine::CEEngine(int num, DataExecuter *dataExecuter)
-{
-    // Implement your constructor here.
-    this->dataExecuter = dataExecuter;
-}
+//
+// You should modify this file.
+//
+#include <common/Root.h>
+#include <CardinalityEstimation.h>
+#include <cstring>
+#include <sstream>
+
+void CEEngine::insertTuple(const std::vector<int>& tuple)
+{
+    insertTuple(tuple.data(), (int)tuple.size());
+}
+
+void CEEngine::deleteTuple(const std::vector<int>& tuple, int tupleId)
+{
+    deleteTuple(tuple.data(), (int)tuple.size(), tupleId);
+}
+
+void CEEngine::insertTuple(const int *tuple, int columns)
+{
+    CE_PROBE(&instrumentation, PROBE_INSERT, 1);
+    if (!acceptsWidth(columns))
+        return;
+    if (summaries.empty())
+        startColumns(TupleRef(tuple, 1), columns);
+    stage(TupleRef(tuple, 1), nextTupleId++, false);
+}
+
+void CEEngine::deleteTuple(const int *tuple, int columns, int tupleId)
+{
+    CE_PROBE(&instrumentation, PROBE_DELETE, 1);
+    if (columns != (int)summaries.size())
+        return;
+    stageDelete(TupleRef(tuple, 1), tupleId);
+}
+
+void CEEngine::insertBatch(const int *tuples, int count, int columns)
+{
+    CE_PROBE(&instrumentation, PROBE_INSERT, (uint32_t)std::max(0, count));
+    if (count <= 0 || !acceptsWidth(columns))
+        return;
+    if (summaries.empty())
+        startColumns(TupleRef(tuples, 1), columns);
+    for (int i = 0; i < count; ++i)
+        stage(TupleRef(tuples + (size_t)i * columns, 1), nextTupleId++, false);
+}
+
+void CEEngine::deleteBatch(const int *tuples, const int *tupleIds, int count, int columns)
+{
+    CE_PROBE(&instrumentation, PROBE_DELETE, (uint32_t)std::max(0, count));
+    if (columns != (int)summaries.size())
+        return;
+    for (int i = 0; i < count; ++i)
+        stageDelete(TupleRef(tuples + (size_t)i * columns, 1), tupleIds[i]);
+}
+
+bool CEEngine::acceptsWidth(int columns) const
+{
+    // stage reads one value per known column, so a tuple of another width would be read out of bounds.
+    return summaries.empty() ? columns > 0 : columns == (int)summaries.size();
+}
+
+void CEEngine::startColumns(TupleRef tuple, int columns)
+{
+    ensureColumns(columns);
+    // A store started from one tuple widens its coding as the values spread.
+    std::vector<ColumnPlan> plans(columns);
+    for (int c = 0; c < columns && config.packSample; ++c) {
+        int value = tuple[c];
+        plans[c] = SampleStore::planColumn(&value, 1);
+    }
+    reservoir.setColumns(columns, &arena, &plans);
+    tail.setColumns(columns, &arena, &plans);
+}
+
+void CEEngine::stageDelete(TupleRef tuple, int tupleId)
+{
+    // The tombstone is set at once, so that maintenance never rereads a tuple whose deletion is still staged.
+    if (tupleId >= 0) {
+        if ((int)tombstones.size() <= (tupleId >> 6))
+            tombstones.resize(std::max((size_t)(tupleId >> 6) + 1, tombstones.size() * 2), 0);
+        tombstones[tupleId >> 6] |= 1ULL << (tupleId & 63);
+    }
+    stage(tuple, tupleId, true);
+}
+
+void CEEngine::stage(TupleRef tuple, int tupleId, bool deleted)
+{
+    for (int c = 0; c < (int)summaries.size(); ++c)
+        stagedValues.push_back(tuple[c]);
+    stagedIds.push_back(tupleId);
+    stagedDeletes.push_back(deleted);
+    if ((int)stagedIds.size() >= config.stagingCapacity)
+        applyStaged();
+}
+
+void CEEngine::applyStaged()
+{
+    int count = (int)stagedIds.size();
+    if (count == 0)
+        return;
+    CE_PROBE(&instrumentation, PROBE_STAGED, (uint32_t)count);
+    maintenanceVersion++;
+    int columns = (int)summaries.size();
+    const int *values = stagedValues.data();
+    const uint8_t *deleted = stagedDeletes.data();
+    // Every synopsis takes the whole batch while it is in cache. The updates of a column keep their order, so the
+    // synopses end up as if the tuples had been applied one by one.
+    for (int c = 0; c < columns; ++c) {
+        ColumnSummary &summary = summaries[c];
+        for (int k = 0; k < count; ++k) {
+            if (!deleted[k])
+                summary.add(values[k * columns + c]);
+        }
+        columnEpochs[c] += count;
+    }
+    columnEstimators.apply(values, deleted, count, columns);
+    for (int g = 0; g < (int)grids.size(); ++g) {
+        GridHistogram &grid = grids[g];
+        int first = grid.getFirst();
+        int second = grid.getSecond();
+        for (int k = 0; k < count; ++k) {
+            if (deleted[k])
+                grid.remove(values[k * columns + first], values[k * columns + second]);
+            else
+                grid.insert(values[k * columns + first], values[k * columns + second]);
+        }
+    }
+    // The strata follow the arrival order, since a staged tuple may be deleted before it was applied.
+    for (int k = 0; k < count; ++k) {
+        int tupleId = stagedIds[k];
+        if (deleted[k]) {
+            if (inTail(tupleId))
+                tail.remove(tupleId);
+            else
+                reservoir.remove(tupleId);
+            drift.recordDelete();
+            continue;
+        }
+        // Appended tuples only enter the tail stratum. The sample keeps its size by taking the slot from the old stratum.
+        tail.insert(TupleRef(values + (size_t)k * columns, 1), tupleId);
+        if (sampleSize() > config.sampleCapacity)
+            reservoir.shrink();
+        drift.recordInsert();
+    }
+    stagedValues.clear();
+    stagedIds.clear();
+    stagedDeletes.clear();
+}
+
+// Query paths indexed by QueryShape. The single-predicate paths ignore Second.
+const CEEngine::ShapePath CEEngine::shapePaths[SHAPE_COUNT] = {
+    &CEEngine::queryGeneric,
+    &CEEngine::queryShaped<1, EQUAL, EQUAL>,
+    &CEEngine::queryShaped<1, GREATER, GREATER>,
+    &CEEngine::queryShaped<2, EQUAL, GREATER>,
+    &CEEngine::queryShaped<2, GREATER, GREATER>,
+};
+
+int CEEngine::query(const std::vector<CompareExpression>& quals)
+{
+    CE_PROBE(&instrumentation, PROBE_QUERY, (uint32_t)quals.size());
+    applyStaged();
+    countPredicates(quals);
+    if (sampleSize() == 0)
+        return 0;
+    double result = (this->*shapePaths[shapeOf(quals)])(quals);
+    return (int)std::llround(std::max(0.0, result));
+}
+
+void CEEngine::queryBatch(const std::vector<std::vector<CompareExpression>> &batch, std::vector<int> &out)
+{
+    CE_PROBE(&instrumentation, PROBE_BATCH, (uint32_t)batch.size());
+    out.assign(batch.size(), 0);
+    applyStaged();
+    for (int i = 0; i < (int)batch.size(); ++i)
+        countPredicates(batch[i]);
+    if (sampleSize() == 0)
+        return;
+    int columns = reservoir.getStore().columnCount();
+    double rows = (double)livePopulation();
+    batchBounds.clear();
+    batchSample.clear();
+    batchMissed.clear();
+    batchEstimates.assign(batch.size(), 0.0);
+    for (int i = 0; i < (int)batch.size(); ++i) {
+        const std::vector<CompareExpression> &quals = batch[i];
+        bool valid = true;
+        for (int j = 0; j < (int)quals.size(); ++j)
+            valid = valid && quals[j].columnIdx >= 0 && quals[j].columnIdx < columns;
+        if (!valid || !reduceQuals(quals, ranges))
+            continue;
+        // Estimates cached by earlier queries are reused like in query(), and the missing ones are stored below.
+        if (cache.lookup(EstimateCache::hashKey(ranges), ranges, columnEpochs.data(), columnVersions.data(), rows,
+                         batchEstimates[i]))
+            continue;
+        batchMissed.push_back(i);
+        QueryPlan plan = choosePlan();
+        if (plan == PLAN_COLUMN && !ranges[0].isPoint()) {
+            // The range is the rows above from - 1 minus the rows above to, as in estimateRange. A range without a
+            // lower bound is rare and left to estimateRange.
+            const ColumnRange &range = ranges[0];
+            if (range.from <= INT32_MIN) {
+                batchEstimates[i] = estimateRange(range);
+            } else {
+                batchBounds.push_back({range.column, (int)(range.from - 1), i, 1.0});
+                if (range.to < INT32_MAX)
+                    batchBounds.push_back({range.column, (int)range.to, i, -1.0});
+            }
+        } else if (plan == PLAN_SAMPLE) {
+            batchSample.push_back(i);
+        } else {
+            batchEstimates[i] = estimate(quals, plan);
+        }
+    }
+    estimateBounds();
+    // Bitmaps of the distinct predicates of consecutive sample queries are kept within a fixed budget.
+    static const size_t MASK_BUDGET_WORDS = 1 << 20;
+    size_t words = (size_t)std::max(reservoir.getStore().usedWords(), tail.getStore().usedWords());
+    for (int first = 0; first < (int)batchSample.size();) {
+        int last = first;
+        size_t predicates = 0;
+        do {
+            predicates += batch[batchSample[last++]].size();
+        } while (last < (int)batchSample.size() &&
+                 (predicates + batch[batchSample[last]].size()) * words <= MASK_BUDGET_WORDS);
+        countSampleBatch(batch, first, last);
+        first = last;
+    }
+    for (int k = 0; k < (int)batchMissed.size(); ++k) {
+        int i = batchMissed[k];
+        reduceQuals(batch[i], ranges);
+        cache.store(EstimateCache::hashKey(ranges), ranges, columnEpochs.data(), columnVersions.data(), rows,
+                    batchEstimates[i]);
+    }
+    for (int i = 0; i < (int)batch.size(); ++i)
+        out[i] = (int)std::llround(std::max(0.0, batchEstimates[i]));
+}
+
+void CEEngine::estimateBounds()
+{
+    std::sort(batchBounds.begin(), batchBounds.end(), [](const BatchBound &a, const BatchBound &b) {
+        return a.column != b.column ? a.column < b.column : a.value < b.value;
+    });
+    for (int first = 0; first < (int)batchBounds.size();) {
+        int column = batchBounds[first].column;
+        int last = first;
+        batchValues.clear();
+        while (last < (int)batchBounds.size() && batchBounds[last].column == column)
+            batchValues.push_back(batchBounds[last++].value);
+        batchGreater.resize(batchValues.size());
+        int count = (int)batchValues.size();
+        if (!columnEstimators.estimateSorted(column, batchValues.data(), count, batchGreater.data())) {
+            for (int k = 0; k < count; ++k)
+                batchGreater[k] = uniformEstimate({column, (long long)batchValues[k] + 1, (long long)INT32_MAX});
+        }
+        for (int k = first; k < last; ++k)
+            batchEstimates[batchBounds[k].query] += batchBounds[k].sign * batchGreater[k - first];
+        first = last;
+    }
+}
+
+void CEEngine::countSampleBatch(const std::vector<std::vector<CompareExpression>> &batch, int first, int last)
+{
+    auto before = [](const CompareExpression &a, const CompareExpression &b) {
+        if (a.columnIdx != b.columnIdx)
+            return a.columnIdx < b.columnIdx;
+        return a.compareOp != b.compareOp ? a.compareOp < b.compareOp : a.value < b.value;
+    };
+    auto same = [](const CompareExpression &a, const CompareExpression &b) {
+        return a.columnIdx == b.columnIdx && a.compareOp == b.compareOp && a.value == b.value;
+    };
+    // Only predicates used by several queries get a mask of their own; the others are evaluated per query, exactly
+    // as query() would.
+    batchPredicates.clear();
+    for (int k = first; k < last; ++k)
+        batchPredicates.insert(batchPredicates.end(), batch[batchSample[k]].begin(), batch[batchSample[k]].end());
+    std::sort(batchPredicates.begin(), batchPredicates.end(), before);
+    int shared = 0;
+    for (int p = 0, q; p < (int)batchPredicates.size(); p = q) {
+        for (q = p + 1; q < (int)batchPredicates.size() && same(batchPredicates[q], batchPredicates[p]);)
+            q++;
+        if (q - p > 1)
+            batchPredicates[shared++] = batchPredicates[p];
+    }
+    batchPredicates.resize(shared);
+    const Reservoir *strata[2] = {&reservoir, &tail};
+    for (int s = 0; s < 2; ++s) {
+        const SampleStore &store = strata[s]->getStore();
+        if (strata[s]->size() == 0)
+            continue;
+        int words = store.usedWords();
+        batchMasks.resize((size_t)shared * words);
+        for (int p = 0; p < shared; ++p)
+            selectPredicate(store, batchPredicates[p], batchMasks.data() + (size_t)p * words, false);
+        if ((int)mask.size() < words)
+            mask.resize(words);
+        double weight = weightOf(*strata[s]);
+        for (int k = first; k < last; ++k) {
+            const std::vector<CompareExpression> &quals = batch[batchSample[k]];
+            batchRows.clear();
+            for (int j = 0; j < (int)quals.size(); ++j) {
+                auto it = std::lower_bound(batchPredicates.begin(), batchPredicates.end(), quals[j], before);
+                if (it != batchPredicates.end() && same(*it, quals[j]))
+                    batchRows.push_back(batchMasks.data() + (size_t)(it - batchPredicates.begin()) * words);
+            }
+            int count;
+            if (batchRows.empty()) {
+                count = countMatches(store, quals, mask);
+            } else {
+                // The unshared predicates are intersected in the scratch mask, which joins the shared masks.
+                bool scratch = false;
+                for (int j = 0; j < (int)quals.size(); ++j) {
+                    auto it = std::lower_bound(batchPredicates.begin(), batchPredicates.end(), quals[j], before);
+                    if (it == batchPredicates.end() || !same(*it, quals[j])) {
+                        selectPredicate(store, quals[j], mask.data(), scratch);
+                        scratch = true;
+                    }
+                }
+                if (scratch)
+                    batchRows.push_back(mask.data());
+                count = countMasks(batchRows.data(), (int)batchRows.size(), store.liveWords(), words);
+            }
+            batchEstimates[batchSample[k]] += count * weight;
+        }
+    }
+}
+
+void CEEngine::countPredicates(const std::vector<CompareExpression> &quals)
+{
+    unsigned columns = (unsigned)equalHits.size();
+    for (int j = 0; j < (int)quals.size(); ++j) {
+        unsigned c = (unsigned)quals[j].columnIdx;
+        if (c < columns)
+            (quals[j].compareOp == EQUAL ? equalHits : rangeHits)[c]++;
+    }
+    budgetQueries++;
+}
+
+QueryShape CEEngine::shapeOf(const std::vector<CompareExpression> &quals) const
+{
+    // Shapes of two predicates on distinct columns, by operator pair. Two equalities are rare enough to stay generic.
+    static const QueryShape pairShapes[2][2] = {{SHAPE_GENERIC, SHAPE_EQUAL_GREATER},
+                                                {SHAPE_EQUAL_GREATER, SHAPE_GREATER_GREATER}};
+    unsigned columns = (unsigned)reservoir.getStore().columnCount();
+    if (quals.size() == 1 && (unsigned)quals[0].columnIdx < columns)
+        return quals[0].compareOp == EQUAL ? SHAPE_EQUAL : SHAPE_GREATER;
+    if (quals.size() == 2 && (unsigned)quals[0].columnIdx < columns && (unsigned)quals[1].columnIdx < columns &&
+        quals[0].columnIdx != quals[1].columnIdx)
+        return pairShapes[quals[0].compareOp != EQUAL][quals[1].compareOp != EQUAL];
+    return SHAPE_GENERIC;
+}
+
+double CEEngine::queryGeneric(const std::vector<CompareExpression> &quals)
+{
+    const SampleStore &store = reservoir.getStore();
+    for (int j = 0; j < (int)quals.size(); ++j) {
+        if (quals[j].columnIdx < 0 || quals[j].columnIdx >= store.columnCount())
+            return 0;
+    }
+    if (!reduceQuals(quals, ranges))
+        return 0;
+    return cachedEstimate(quals, choosePlan());
+}
+
+template <int Columns, CompareOp First, CompareOp Second>
+double CEEngine::queryShaped(const std::vector<CompareExpression> &quals)
+{
+    // The shape fixes the operators and the number of columns, so the ranges are built without reduceQuals. For the
+    // mixed shape the equality may come second; its position is the operator of the first predicate.
+    ranges.resize(Columns);
+    if (Columns == 1) {
+        ranges[0] = rangeOf<First>(quals[0]);
+        if (ranges[0].isEmpty())
+            return 0;
+    } else {
+        int first = First == Second ? 0 : (int)quals[0].compareOp;
+        ColumnRange a = rangeOf<First>(quals[first]);
+        ColumnRange b = rangeOf<Second>(quals[1 - first]);
+        if (b.isEmpty())
+            return 0;
+        bool ordered = a.column < b.column;
+        ranges[0] = ordered ? a : b;
+        ranges[1] = ordered ? b : a;
+    }
+    QueryPlan plan = PLAN_SAMPLE;
+    if (!sampleIsExact() && columnEstimators.columns() > 0) {
+        if (Columns == 1)
+            plan = PLAN_COLUMN;
+        else if (findGrid(ranges[0].column, ranges[1].column) != nullptr)
+            plan = PLAN_GRID;
+    }
+    return cachedEstimate(quals, plan);
+}
+
+double CEEngine::cachedEstimate(const std::vector<CompareExpression> &quals, QueryPlan plan)
+{
+    double rows = (double)livePopulation();
+    double result;
+    uint64_t hash = EstimateCache::hashKey(ranges);
+    if (!cache.lookup(hash, ranges, columnEpochs.data(), columnVersions.data(), rows, result)) {
+        result = estimate(quals, plan);
+        cache.store(hash, ranges, columnEpochs.data(), columnVersions.data(), rows, result);
+    }
+    return result;
+}
+
+double CEEngine::estimate(const std::vector<CompareExpression> &quals, QueryPlan plan)
+{
+    switch (plan) {
+        case PLAN_COLUMN:
+            return estimateRange(ranges[0]);
+        case PLAN_GRID:
+            return estimateGrid(*findGrid(ranges[0].column, ranges[1].column));
+        default: {
+            // Every stratum contributes its matches scaled by the rows one of its sampled tuples stands for.
+            double result = 0;
+            if (reservoir.size() > 0)
+                result += countMatches(reservoir.getStore(), quals, mask) * weightOf(reservoir);
+            if (tail.size() > 0)
+                result += countMatches(tail.getStore(), quals, mask) * weightOf(tail);
+            return result;
+        }
+    }
+}
+
+QueryPlan CEEngine::choosePlan() const
+{
+    // An exact sample beats any synopsis. Otherwise a single column is answered by its histogram or sketch and a
+    // column pair by its grid; wider conjunctions fall back to the sample, which keeps every correlation.
+    if (sampleIsExact() || columnEstimators.columns() == 0)
+        return PLAN_SAMPLE;
+    if (ranges.size() == 1)
+        return PLAN_COLUMN;
+    if (ranges.size() == 2 && findGrid(ranges[0].column, ranges[1].column) != nullptr)
+        return PLAN_GRID;
+    return PLAN_SAMPLE;
+}
+
+double CEEngine::estimateRange(const ColumnRange &range) const
+{
+    double prior = uniformEstimate(range);
+    if (range.isPoint() && prior == 0)
+        return 0;
+    double rows;
+    return columnEstimators.estimate(range, prior, rows) ? rows : prior;
+}
+
+double CEEngine::estimateGrid(const GridHistogram &grid) const
+{
+    // The grid only measures how far the pair departs from independence; the per-column synopses, which are finer,
+    // still provide the marginals.
+    double marginalA;
+    double marginalB;
+    double joint = grid.estimate(ranges[0], ranges[1], marginalA, marginalB);
+    if (marginalA <= 0 || marginalB <= 0)
+        return joint;
+    double correlation = joint / marginalA / marginalB;
+    return correlation * estimateRange(ranges[0]) * estimateRange(ranges[1]);
+}
+
+const GridHistogram *CEEngine::findGrid(int first, int second) const
+{
+    int columns = columnEstimators.columns();
+    if (first >= columns || second >= columns)
+        return nullptr;
+    int g = gridOf[first * columns + second];
+    return g < 0 ? nullptr : &grids[g];
+}
+
+void CEEngine::prepare()
+{
+    CE_PROBE(&instrumentation, PROBE_PREPARE, 0);
+    actions++;
+    if (scheduler.run() > 0)
+        maintenanceVersion++;
+}
+
+void CEEngine::registerMaintenance()
+{
+    scheduler.setBudget(config.prepareMaxSteps, config.prepareBudgetUs);
+    scheduler.addTask("staging", [this]() { return stagingStep(); });
+    scheduler.addTask("estimators", [this]() { return estimatorsStep(); });
+    scheduler.addTask("refresh", [this]() { return refreshStep(); });
+    scheduler.addTask("drift", [this]() { return driftStep(); });
+    scheduler.addTask("cdf", [this]() { return cdfStep(); });
+    scheduler.addTask("budget", [this]() { return budgetStep(); });
+}
+
+bool CEEngine::stagingStep()
+{
+    // Applying the staged tuples before the staging area fills keeps the pass off the insert and delete calls.
+    if (stagedIds.empty() || (int)stagedIds.size() * 2 < config.stagingCapacity)
+        return false;
+    applyStaged();
+    return true;
+}
+
+bool CEEngine::estimatorsStep()
+{
+    // One slice of the maintenance of every estimator of every column, e.g. folding the corrections of the CDF models,
+    // so that an estimate misses at most the updates since the last prepare().
+    if (idleSince(estimatorsIdle))
+        return false;
+    bool work = false;
+    for (int c = 0; c < columnEstimators.columns(); ++c) {
+        if (columnEstimators.maintain(c, config.compactSlice)) {
+            columnVersions[c]++;
+            work = true;
+        }
+    }
+    if (!work)
+        estimatorsIdle = maintenanceVersion;
+    return work;
+}
+
+bool CEEngine::refreshStep()
+{
+    // Read a random chunk not read before and swap its unsampled tuples in with the sampling rate, so the sample
+    // drifts away from the blocks picked by the bootstrap while keeping its density in every chunk. Random pairing
+    // keeps the sample uniform under updates, so once nearly every initial tuple has been read the rereads cannot
+    // improve it. Only the initial tuples are reread; the tail stratum sees every appended tuple.
+    if (reservoir.isExact() || reservoir.size() == 0 || tailStart == 0 ||
+        actions - lastRefresh < config.refreshInterval ||
+        (double)coveredTuples >= config.refreshCoverage * initialTuples)
+        return false;
+    lastRefresh = actions;
+    // Chunks are aligned on the coverage ones. Rereading a chunk would give its tuples a second chance to enter the
+    // sample, so the first chunk never read from a random one on is taken.
+    int chunks = std::min((tailStart + coverageChunk - 1) / coverageChunk, (int)coveredChunks.size() * 64);
+    int first = (int)(rng() % (unsigned long long)chunks);
+    int chunk = -1;
+    for (int k = 0; k < chunks && chunk < 0; ++k) {
+        int c = (first + k) % chunks;
+        if (((coveredChunks[c >> 6] >> (c & 63)) & 1) == 0)
+            chunk = c;
+    }
+    if (chunk < 0)
+        return false;
+    int start = chunk * coverageChunk;
+    int len = std::min(coverageChunk, tailStart - start);
+    int rows = reader.read(start, len);
+    cover(start, len);
+    double rate = (double)reservoir.size() / std::max(1LL, reservoir.getPopulation());
+    std::uniform_real_distribution<double> coin(0, 1);
+    int tupleId = start;
+    for (int i = 0; i < rows; ++i, ++tupleId) {
+        while (tupleId < start + len && isDeleted(tupleId))
+            tupleId++;
+        if (tupleId >= start + len)
+            break;
+        if (!reservoir.contains(tupleId) && coin(rng) < rate)
+            reservoir.swapIn(reader.tuple(i), tupleId);
+    }
+    return true;
+}
+
+void CEEngine::cover(int start, int len)
+{
+    // Only chunks read whole count; the last chunk of the initial tuples may be shorter.
+    long long end = std::min((long long)start + len, initialTuples);
+    for (long long k = ((long long)start + coverageChunk - 1) / coverageChunk;; ++k) {
+        long long chunkEnd = std::min((k + 1) * coverageChunk, initialTuples);
+        if (chunkEnd > end || k * coverageChunk >= chunkEnd)
+            break;
+        uint64_t bit = 1ULL << (k & 63);
+        if ((coveredChunks[k >> 6] & bit) == 0) {
+            coveredChunks[k >> 6] |= bit;
+            coveredTuples += chunkEnd - k * coverageChunk;
+        }
+    }
+}
+
+bool CEEngine::driftStep()
+{
+    // Check one column at a time, one slice of the sample per step, and only once its tuples changed enough.
+    ArenaVector<EquiDepthHistogram> *histograms = columnEstimators.find<EquiDepthHistogram>();
+    if (histograms == nullptr || histograms->empty() || sampleIsExact() || sampleSize() == 0)
+        return false;
+    if (!drift.checking()) {
+        if (idleSince(driftIdle))
+            return false;
+        int c = drift.due((long long)(config.driftCheckFraction * livePopulation()));
+        if (c < 0 || (*histograms)[c].empty() || (*histograms)[c].resizing()) {
+            driftIdle = maintenanceVersion;
+            return false;
+        }
+        drift.start(c, (*histograms)[c]);
+        return true;
+    }
+    const Reservoir &stratum = drift.getStratum() == 0 ? reservoir : tail;
+    if (!drift.scan(stratum.getStore(), weightOf(stratum), std::max(1, config.driftSlice / 64)) || drift.getStratum() < 2)
+        return true;
+    // Critical value of the one-sample KS test at the 1% level.
+    double noise = 1.63 / std::sqrt((double)sampleSize());
+    int c = drift.getColumn();
+    if (drift.finish((*histograms)[c], std::max(config.driftThreshold, noise), config.driftRepairs) > 0)
+        columnVersions[c]++;
+    return true;
+}
+
+bool CEEngine::cdfStep()
+{
+    // Refit the model of a column from the sample once its updates add up to a share of its rows; the corrections are
+    // folded by estimatorsStep.
+    ArenaVector<CdfModel> *models = columnEstimators.find<CdfModel>();
+    if (models == nullptr || (refitColumn < 0 && idleSince(cdfIdle)) || sampleSize() == 0)
+        return false;
+    if (refitColumn < 0) {
+        for (int c = 0; c < (int)models->size(); ++c) {
+            CdfModel &model = (*models)[c];
+            if (model.usable() && model.getChanges() >= config.cdfRefitFraction * model.getTotal()) {
+                refitColumn = c;
+                model.startRefit();
+                return true;
+            }
+        }
+        cdfIdle = maintenanceVersion;
+        return false;
+    }
+    CdfModel &model = (*models)[refitColumn];
+    const Reservoir &stratum = model.getStratum() == 0 ? reservoir : tail;
+    if (model.scan(stratum.getStore(), refitColumn, weightOf(stratum), std::max(1, config.cdfSlice / 64)) &&
+        model.getStratum() >= 2) {
+        model.finishRefit();
+        columnVersions[refitColumn]++;
+        refitColumn = -1;
+    }
+    return true;
+}
+
+// Largest multiple of its configured size a synopsis is given under a memory budget.
+static const double BUDGET_SPREAD = 4;
+
+// Most buckets a histogram may get.
+static int bucketLimit(const EngineConfig &config)
+{
+    return CEEngine::adaptsBudget(config) ? (int)BUDGET_SPREAD * config.histogramBuckets : config.histogramBuckets;
+}
+
+bool CEEngine::budgetStep()
+{
+    // One resize per slice, or one slice of the sample read into the synopsis being grown. The memory moves between
+    // the histograms and sketches of the pipeline; a composition without them has nothing to resize.
+    ArenaVector<EquiDepthHistogram> *histograms = columnEstimators.find<EquiDepthHistogram>();
+    ArenaVector<FrequencySketch> *sketches = columnEstimators.find<FrequencySketch>();
+    if (!adaptsBudget(config) || (histograms == nullptr && sketches == nullptr) || columnEstimators.columns() == 0 ||
+        sampleSize() == 0)
+        return false;
+    if (budgetColumn < 0) {
+        if (budgetQueries < config.budgetInterval)
+            return false;
+        planBudget();
+        budgetColumn = 0;
+        budgetGrowing = false;
+        return true;
+    }
+    int columns = columnEstimators.columns();
+    int words = std::max(1, config.driftSlice / 64);
+    for (; budgetColumn < columns; ++budgetColumn) {
+        int c = budgetColumn;
+        EquiDepthHistogram *histogram = histograms == nullptr ? nullptr : &(*histograms)[c];
+        FrequencySketch *sketch = sketches == nullptr ? nullptr : &(*sketches)[c];
+        if (histogram != nullptr && histogram->resizing()) {
+            const Reservoir &stratum = histogram->getStratum() == 0 ? reservoir : tail;
+            if (histogram->scan(stratum.getStore(), c, weightOf(stratum), words) && histogram->getStratum() >= 2 &&
+                histogram->finishResize())
+                columnVersions[c]++;
+            return true;
+        }
+        if (sketch != nullptr && sketch->isGrowing()) {
+            const Reservoir &stratum = sketch->getStratum() == 0 ? reservoir : tail;
+            uint32_t weight = (uint32_t)std::max(1LL, std::llround(weightOf(stratum)));
+            if (sketch->scan(stratum.getStore(), c, weight, words) && sketch->getStratum() >= 2) {
+                sketch->finishGrow();
+                columnVersions[c]++;
+            }
+            return true;
+        }
+        // A synopsis only grows if the arena can hold it next to the one it replaces. planBudget leaves the targets
+        // of a missing estimator at 0.
+        int buckets = bucketTargets[c];
+        if (buckets > 0 && (buckets > histogram->bucketCount()) == budgetGrowing) {
+            bucketTargets[c] = 0;
+            bool checked = drift.checking() && drift.getColumn() == c;
+            if (!checked && (!budgetGrowing || arena.fits((size_t)(buckets + 1) * sizeof(double))) &&
+                !histogram->startResize(buckets, &arena))
+                columnVersions[c]++;
+            return true;
+        }
+        int width = widthTargets[c];
+        if (width > 0 && (width > sketch->getWidth()) == budgetGrowing) {
+            widthTargets[c] = 0;
+            if (!budgetGrowing) {
+                sketch->shrink(width, &arena);
+                columnVersions[c]++;
+            } else if (arena.fits((size_t)config.sketchDepth * width * sizeof(uint32_t))) {
+                sketch->startGrow(width, rng, &arena);
+            }
+            return true;
+        }
+    }
+    if (!budgetGrowing) {
+        budgetGrowing = true;
+        budgetColumn = 0;
+        return true;
+    }
+    // Older rounds count half as much, so the shares follow a change of the query mix.
+    for (int c = 0; c < columns; ++c) {
+        equalHits[c] /= 2;
+        rangeHits[c] /= 2;
+    }
+    budgetQueries = 0;
+    budgetColumn = -1;
+    return true;
+}
+
+void CEEngine::planBudget()
+{
+    // Every column keeps a quarter of an even share of the buckets and counters, and the rest follows the predicates
+    // it got. No synopsis gets more than BUDGET_SPREAD times its configured size and the targets add up to about the
+    // configured sizes, so the statistics stay within the memory reserved for them; budgetStep only grows a synopsis
+    // when the arena still has room for it.
+    const ArenaVector<EquiDepthHistogram> *histograms = columnEstimators.find<EquiDepthHistogram>();
+    const ArenaVector<FrequencySketch> *sketches = columnEstimators.find<FrequencySketch>();
+    int columns = columnEstimators.columns();
+    double equalSum = 0;
+    double rangeSum = 0;
+    for (int c = 0; c < columns; ++c) {
+        equalSum += equalHits[c];
+        rangeSum += rangeHits[c];
+    }
+    int baseWidth = 1;
+    while (baseWidth < config.sketchWidth)
+        baseWidth <<= 1;
+    for (int c = 0; c < columns; ++c) {
+        double rangeShare = 0.25 + 0.75 * (rangeSum > 0 ? rangeHits[c] * columns / rangeSum : 1.0);
+        double equalShare = 0.25 + 0.75 * (equalSum > 0 ? equalHits[c] * columns / equalSum : 1.0);
+        int buckets = (int)std::max(2.0, std::floor(config.histogramBuckets * std::min(rangeShare, BUDGET_SPREAD)));
+        int current = bucketCountOf(c);
+        // Small changes are not worth rebuilding a histogram for.
+        bucketTargets[c] =
+            histograms == nullptr || (*histograms)[c].empty() || std::abs(buckets - current) * 4 <= current ? 0 : buckets;
+        // Widths are powers of two, so the share is rounded to the nearest one on a log scale.
+        int width = std::max(1, baseWidth / 4);
+        while (width * 2 <= std::min(equalShare, BUDGET_SPREAD) * baseWidth * M_SQRT2)
+            width *= 2;
+        widthTargets[c] = sketches == nullptr || (*sketches)[c].empty() || width == (*sketches)[c].getWidth() ? 0 : width;
+    }
+}
+
+int CEEngine::bucketCountOf(int column) const
+{
+    const ArenaVector<EquiDepthHistogram> *histograms = columnEstimators.find<EquiDepthHistogram>();
+    return histograms == nullptr ? 0 : (*histograms)[column].bucketCount();
+}
+
+int CEEngine::sketchWidthOf(int column) const
+{
+    const ArenaVector<FrequencySketch> *sketches = columnEstimators.find<FrequencySketch>();
+    return sketches == nullptr ? 0 : (*sketches)[column].getWidth();
+}
+
+CEEngine::CEEngine(int num, DataExecuter *dataExecuter) : CEEngine(num, dataExecuter, EngineConfig())
+{
+}
+
+CEEngine::CEEngine(int num, DataExecuter *dataExecuter, const EngineConfig &config)
+    : config(config), rng(config.seed), reservoir(config.sampleCapacity, &rng),
+      tail(tailCapacity(num, config), &rng),
+      summaries(ArenaAllocator<ColumnSummary>(&arena)), columnEstimators(&arena),
+      grids(ArenaAllocator<GridHistogram>(&arena)),
+      gridOf(ArenaAllocator<int>(&arena)), columnEpochs(ArenaAllocator<long long>(&arena)),
+      columnVersions(ArenaAllocator<long long>(&arena)), tombstones(ArenaAllocator<uint64_t>(&arena)),
+      stagedValues(ArenaAllocator<int>(&arena)), stagedIds(ArenaAllocator<int>(&arena)),
+      stagedDeletes(ArenaAllocator<uint8_t>(&arena)), equalHits(ArenaAllocator<long long>(&arena)),
+      rangeHits(ArenaAllocator<long long>(&arena)), bucketTargets(ArenaAllocator<int>(&arena)),
+      widthTargets(ArenaAllocator<int>(&arena)), coveredChunks(ArenaAllocator<uint64_t>(&arena)),
+      reader(dataExecuter, config.readerCacheBytes)
+{
+    this->dataExecuter = dataExecuter;
+    this->nextTupleId = num;
+    this->tailStart = num;
+    this->actions = 0;
+    this->lastRefresh = 0;
+    this->refitColumn = -1;
+    this->maintenanceVersion = 0;
+    this->estimatorsIdle = -1;
+    this->driftIdle = -1;
+    this->cdfIdle = -1;
+    this->budgetQueries = 0;
+    this->budgetColumn = -1;
+    this->budgetGrowing = false;
+    this->initialTuples = num;
+    this->coveredTuples = 0;
+    this->coverageChunk = 1;
+    this->warmStarted = false;
+#ifdef CE_INSTRUMENT
+    reader.setInstrumentation(&instrumentation);
+#endif
+    // The statistics are sized from the configuration, the table shape and the coding of the sampled columns, so the
+    // whole engine lives in one block.
+    std::vector<ColumnPlan> plans = previewPlans(num);
+    int columns = (int)plans.size();
+    if (config.memoryBudget > 0 && columns > 0) {
+        this->config = budgetConfig(num, plans, config);
+        reservoir = Reservoir(this->config.sampleCapacity, &rng);
+        tail = Reservoir(tailCapacity(num, this->config), &rng);
+        reader = TupleBatchReader(dataExecuter, this->config.readerCacheBytes);
+#ifdef CE_INSTRUMENT
+        reader.setInstrumentation(&instrumentation);
+#endif
+    }
+    arena.reserve(estimateArenaBytes(num, plans, this->config));
+    tombstones.reserve(((size_t)num >> 6) + 1);
+    coverageChunk = std::max(1, std::min(this->config.refreshChunk, reader.batchLimit()));
+    coveredChunks.assign(((size_t)num / coverageChunk >> 6) + 1, 0);
+    cache.init(this->config.cacheEntries, this->config.cacheTolerance, &arena);
+    registerMaintenance();
+    if (!this->config.snapshotPath.empty() && loadSnapshot(num, columns)) {
+        warmStarted = true;
+        return;
+    }
+    SampleBootstrap sampler(this->config, reader, &rng);
+    bootstrap = sampler.run(num, reservoir, summaries, &arena, plans);
+    const std::vector<std::pair<int, int>> &read = sampler.getReadRanges();
+    for (int k = 0; k < (int)read.size(); ++k)
+        cover(read[k].first, read[k].second);
+    // A partial read gives every initial tuple the same inclusion probability only while the sample stops growing.
+    if (!bootstrap.fullScan)
+        reservoir.seal();
+    reservoir.start(num);
+    if (reservoir.getStore().initialized()) {
+        std::vector<ColumnPlan> plans = reservoir.getStore().plans();
+        tail.setColumns(reservoir.getStore().columnCount(), &arena, &plans);
+        tail.start(0);
+    }
+    buildSynopses();
+}
+
+CEEngine::~CEEngine()
+{
+    if (!config.statsPath.empty())
+        dumpStats(config.statsPath);
+}
+
+std::string CEEngine::statsJson() const
+{
+#ifdef CE_INSTRUMENT
+    return instrumentation.toJson();
+#else
+    return std::string();
+#endif
+}
+
+MemoryUsage CEEngine::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.budget = config.memoryBudget;
+    usage.planned = estimateArenaBytes((int)initialTuples, reservoir.getStore().plans(), config) +
+                    estimateBufferBytes(config);
+    usage.arenaReserved = arena.getCapacity();
+    usage.arenaUsed = arena.getUsed();
+    usage.arenaFree = arena.getFreeBytes();
+    usage.arenaOverflow = arena.getOverflowBytes();
+    usage.buffers = reader.bufferBytes() + mask.capacity() * sizeof(uint64_t) + ranges.capacity() * sizeof(ColumnRange) +
+                    batchBounds.capacity() * sizeof(BatchBound) + batchValues.capacity() * sizeof(int) +
+                    (batchGreater.capacity() + batchEstimates.capacity()) * sizeof(double) +
+                    (batchMissed.capacity() + batchSample.capacity()) * sizeof(int) +
+                    batchPredicates.capacity() * sizeof(CompareExpression) +
+                    batchMasks.capacity() * sizeof(uint64_t) + batchRows.capacity() * sizeof(uint64_t *);
+    usage.total = usage.arenaReserved + usage.arenaOverflow + usage.buffers;
+    return usage;
+}
+
+bool CEEngine::dumpStats(const std::string &path) const
+{
+#ifdef CE_INSTRUMENT
+    return instrumentation.dump(path);
+#else
+    return false;
+#endif
+}
+
+int CEEngine::tailCapacity(int num, const EngineConfig &config)
+{
+    // Without initial tuples everything is tail, so the tail stratum gets the whole sample.
+    if (num <= 0)
+        return config.sampleCapacity;
+    return std::max(1, (int)(config.sampleCapacity * std::min(1.0, std::max(0.0, config.tailShare))));
+}
+
+// Layout of the engine part of a snapshot; bump it whenever saveSnapshot changes.
+static const uint32_t ENGINE_SNAPSHOT_LAYOUT = 9;
+
+bool CEEngine::saveSnapshot(const std::string &path) const
+{
+    SnapshotWriter out;
+    out.put(ENGINE_SNAPSHOT_LAYOUT);
+    out.put(reservoir.getStore().columnCount());
+    out.put(nextTupleId);
+    out.put(tailStart);
+    // Settings that shape the statistics; a snapshot taken with other ones is not reused.
+    int shape[8] = {config.sampleCapacity, config.histogramBuckets, config.sketchDepth, config.sketchWidth,
+                    config.heavyHitters,   config.gridColumns,      config.gridCells,  tail.getStore().getSlots()};
+    out.put(shape);
+    out.put(actions);
+    out.put(lastRefresh);
+    out.put(initialTuples);
+    out.put(coveredTuples);
+    out.put(coverageChunk);
+    out.putVector(coveredChunks);
+    out.put(bootstrap);
+    std::ostringstream state;
+    state << rng;
+    out.putString(state.str());
+    reservoir.save(out);
+    tail.save(out);
+    out.putVector(summaries);
+    columnEstimators.save(out);
+    out.put((int)grids.size());
+    for (int g = 0; g < (int)grids.size(); ++g)
+        grids[g].save(out);
+    out.putVector(gridOf);
+    out.putVector(columnEpochs);
+    out.putVector(columnVersions);
+    out.putVector(tombstones);
+    out.putVector(stagedValues);
+    out.putVector(stagedIds);
+    out.putVector(stagedDeletes);
+    out.putVector(equalHits);
+    out.putVector(rangeHits);
+    out.put(budgetQueries);
+    return out.writeFile(path);
+}
+
+bool CEEngine::loadSnapshot(int num, int columns)
+{
+    SnapshotReader in;
+    if (!in.open(config.snapshotPath))
+        return false;
+    uint32_t layout = 0;
+    int savedColumns = 0;
+    int savedTuples = 0;
+    int savedTailStart = 0;
+    int shape[8];
+    in.get(layout);
+    in.get(savedColumns);
+    in.get(savedTuples);
+    in.get(savedTailStart);
+    in.get(shape);
+    int expected[8] = {config.sampleCapacity, config.histogramBuckets, config.sketchDepth, config.sketchWidth,
+                       config.heavyHitters,   config.gridColumns,      config.gridCells,  tailCapacity(num, config)};
+    // A snapshot of another table shape or configuration, or one the table has moved too far from, is stale.
+    if (!in.ok() || layout != ENGINE_SNAPSHOT_LAYOUT || savedColumns != columns || columns <= 0 ||
+        memcmp(shape, expected, sizeof(shape)) != 0 || savedTuples > num || savedTailStart > savedTuples ||
+        (long long)num - savedTuples > config.snapshotCatchUpLimit)
+        return false;
+    if (!loadStatistics(in, columns)) {
+        resetStatistics();
+        return false;
+    }
+    nextTupleId = savedTuples;
+    tailStart = savedTailStart;
+    catchUp(savedTuples, num);
+    return true;
+}
+
+bool CEEngine::loadStatistics(SnapshotReader &in, int columns)
+{
+    std::string state;
+    in.get(actions);
+    in.get(lastRefresh);
+    in.get(initialTuples);
+    in.get(coveredTuples);
+    int savedChunk = 0;
+    in.get(savedChunk);
+    in.getVector(coveredChunks);
+    // The coverage of another refresh length cannot be carried over.
+    if (savedChunk != coverageChunk || coveredChunks.size() != ((size_t)initialTuples / coverageChunk >> 6) + 1)
+        return false;
+    in.get(bootstrap);
+    in.getString(state);
+    std::istringstream(state) >> rng;
+    if (!reservoir.load(in, &arena) || reservoir.getStore().columnCount() != columns || !tail.load(in, &arena) ||
+        tail.getStore().columnCount() != columns)
+        return false;
+    in.getVector(summaries);
+    int gridCount = 0;
+    if (!columnEstimators.load(in, columns, &arena))
+        return false;
+    int estimated = columnEstimators.columns();
+    if (!in.get(gridCount) || gridCount < 0 || gridCount > columns * columns)
+        return false;
+    grids.assign(gridCount, GridHistogram());
+    for (int g = 0; g < gridCount; ++g) {
+        if (!grids[g].load(in, &arena))
+            return false;
+    }
+    in.getVector(gridOf);
+    in.getVector(columnEpochs);
+    in.getVector(columnVersions);
+    in.getVector(tombstones);
+    in.getVector(stagedValues);
+    in.getVector(stagedIds);
+    in.getVector(stagedDeletes);
+    in.getVector(equalHits);
+    in.getVector(rangeHits);
+    in.get(budgetQueries);
+    if (!in.ok() || stagedValues.size() != stagedIds.size() * columns || stagedDeletes.size() != stagedIds.size() ||
+        (int)equalHits.size() != columns || (int)rangeHits.size() != columns ||
+        (int)summaries.size() != columns || (int)columnEpochs.size() != columns ||
+        (int)columnVersions.size() != columns || gridOf.size() != (size_t)estimated * estimated)
+        return false;
+    for (int g = 0; g < (int)gridOf.size(); ++g) {
+        if (gridOf[g] >= gridCount)
+            return false;
+    }
+    for (int g = 0; g < gridCount; ++g) {
+        if (grids[g].getFirst() < 0 || grids[g].getSecond() >= columns)
+            return false;
+    }
+    // The snapshot invalidates anything computed before it was loaded. Drift is tracked from the snapshot on.
+    for (int c = 0; c < columns; ++c)
+        columnVersions[c]++;
+    bucketTargets.assign(columns, 0);
+    widthTargets.assign(columns, 0);
+    drift.init(columns, bucketLimit(config), &arena);
+    return true;
+}
+
+void CEEngine::resetStatistics()
+{
+    reservoir = Reservoir(config.sampleCapacity, &rng);
+    tail = Reservoir(tailCapacity(nextTupleId, config), &rng);
+    tailStart = nextTupleId;
+    summaries.clear();
+    columnEstimators.clear();
+    grids.clear();
+    gridOf.clear();
+    columnEpochs.clear();
+    columnVersions.clear();
+    tombstones.clear();
+    stagedValues.clear();
+    stagedIds.clear();
+    stagedDeletes.clear();
+    equalHits.clear();
+    rangeHits.clear();
+    bucketTargets.clear();
+    widthTargets.clear();
+    budgetQueries = 0;
+    budgetColumn = -1;
+    bootstrap = BootstrapResult();
+    actions = 0;
+    lastRefresh = 0;
+    refitColumn = -1;
+    initialTuples = nextTupleId;
+    coveredTuples = 0;
+    coveredChunks.assign(coveredChunks.size(), 0);
+    rng.seed(config.seed);
+}
+
+void CEEngine::catchUp(int from, int num)
+{
+    // Tuples appended since the snapshot go through the insert path. Deletions since the snapshot cannot be seen;
+    // a batch shorter than requested only tells that some tuple in it was deleted, so its tuples get no location.
+    for (int start = from; start < num;) {
+        int count = std::min(num - start, reader.batchLimit());
+        int rows = reader.read(start, count);
+        bool exactIds = rows == count;
+        for (int i = 0; i < rows; ++i)
+            stage(reader.tuple(i), exactIds ? start + i : -1, false);
+        start += count;
+    }
+    applyStaged();
+    nextTupleId = num;
+}
+
+double CEEngine::uniformEstimate(const ColumnRange &range) const
+{
+    const ColumnSummary &summary = summaries[range.column];
+    long long from = std::max(range.from, (long long)summary.min);
+    long long to = std::min(range.to, (long long)summary.max);
+    if (from > to)
+        return 0;
+    double span = (double)summary.max - summary.min + 1;
+    if (!range.isPoint())
+        return livePopulation() * ((double)(to - from + 1) / span);
+    // live rows / NDV is the count of a value known to exist; scaling by the share of the value range that is
+    // occupied keeps it small on sparse domains, where an unseen constant most likely does not occur at all.
+    double ndv = std::max(1.0, summary.ndv);
+    return livePopulation() / ndv * std::min(1.0, ndv / span);
+}
+
+// Tuples previewed by the constructor, in PREVIEW_READS evenly spread reads, to choose the coding of every column.
+static const int PREVIEW_READS = 4;
+static const int PREVIEW_TUPLES = 64;
+
+std::vector<ColumnPlan> CEEngine::previewPlans(int num)
+{
+    std::vector<ColumnPlan> plans;
+    std::vector<std::vector<int32_t>> values;
+    for (int k = 0; k < PREVIEW_READS && num > 0; ++k) {
+        int start = (int)((long long)num * k / PREVIEW_READS);
+        int rows = reader.read(start, std::min(std::min(PREVIEW_TUPLES, num - start), reader.batchLimit()));
+        if (rows > 0 && values.empty())
+            values.resize(reader.columnCount());
+        for (int c = 0; c < (int)values.size() && rows > 0; ++c)
+            values[c].insert(values[c].end(), reader.column(c), reader.column(c) + rows);
+    }
+    plans.resize(values.size());
+    for (int c = 0; c < (int)plans.size() && config.packSample; ++c)
+        plans[c] = SampleStore::planColumn(values[c].data(), (int)values[c].size());
+    return plans;
+}
+
+// Bytes of the codes of one sampled tuple, and of the dictionaries of a sample store.
+static size_t codeBytes(const std::vector<ColumnPlan> &plans)
+{
+    size_t bytes = 0;
+    for (int c = 0; c < (int)plans.size(); ++c)
+        bytes += plans[c].width;
+    return bytes;
+}
+
+static size_t dictionaryBytes(const std::vector<ColumnPlan> &plans)
+{
+    size_t bytes = 0;
+    for (int c = 0; c < (int)plans.size(); ++c)
+        bytes += plans[c].encoding == ENCODE_DICT ? SampleStore::DICTIONARY_LIMIT * sizeof(int32_t) : 0;
+    return bytes;
+}
+
+size_t CEEngine::estimateArenaBytes(int num, const std::vector<ColumnPlan> &plans, const EngineConfig &config)
+{
+    int columns = (int)plans.size();
+    if (columns <= 0)
+        return 0;
+    // The sample store is allocated for the full capacity, whatever the size of the initial data set. A slot holds
+    // the codes of its tuple, its id and its slot index entry.
+    size_t slotBytes = codeBytes(plans) + 4 + 4;
+    size_t slots = ((size_t)std::max(0, config.sampleCapacity) + 63) & ~(size_t)63;
+    size_t sample = slots * slotBytes + slots / 8 + dictionaryBytes(plans);
+    size_t slotMap = SlotIndex::tableBytes(config.sampleCapacity);
+    // The tail stratum has its own store and slot index.
+    size_t tailSlots = ((size_t)tailCapacity(num, config) + 63) & ~(size_t)63;
+    sample += tailSlots * slotBytes + tailSlots / 8 + dictionaryBytes(plans);
+    slotMap += SlotIndex::tableBytes(tailCapacity(num, config));
+    // The histogram and the sketch are the estimators a memory budget resizes.
+    size_t histogram = ColumnPipeline::arenaBytesOf<EquiDepthHistogram>(config);
+    size_t sketch = ColumnPipeline::arenaBytesOf<FrequencySketch>(config);
+    size_t gridColumns = (size_t)std::min(columns, config.gridColumns);
+    size_t cells = (size_t)config.gridCells;
+    size_t grid = cells * cells * sizeof(double) + 2 * cells * (sizeof(int) + sizeof(double));
+    size_t entries = 1;
+    while ((int)entries < config.cacheEntries)
+        entries <<= 1;
+    size_t perColumn = sizeof(ColumnSummary) + ColumnPipeline::arenaBytes(config) + 5 * sizeof(long long) +
+                       columns * sizeof(int) +
+                       (size_t)std::max(1, config.stagingCapacity) * sizeof(int);
+    // Under a memory budget a histogram may get up to BUDGET_SPREAD times its buckets, and one histogram and one sketch
+    // at a time are rebuilt next to the ones they replace.
+    size_t spread = adaptsBudget(config) ? (size_t)BUDGET_SPREAD : 1;
+    size_t driftPoints = (2 * spread * config.histogramBuckets + 3) * (2 * sizeof(int) + sizeof(double));
+    size_t staging = (size_t)std::max(1, config.stagingCapacity) * (sizeof(int) + sizeof(uint8_t));
+    size_t resizing =
+        spread == 1 ? 0 : spread * (histogram + (histogram > 0 ? config.histogramBuckets * sizeof(double) : 0) + sketch);
+    perColumn += spread == 1 ? 0 : 2 * (sizeof(long long) + sizeof(int));
+    size_t bytes = sample + slotMap + staging + columns * perColumn + gridColumns * gridColumns / 2 * (grid + sizeof(GridHistogram)) +
+                   entries * EstimateCache::entryBytes() + driftPoints + resizing + ((size_t)num / 64 + 1) * sizeof(uint64_t) +
+                   ((size_t)num / std::max(1, config.refreshChunk) / 64 + 1) * sizeof(uint64_t);
+    // Alignment padding of every allocation and a few tombstone growths.
+    return bytes + bytes / 8 + (64 << 10);
+}
+
+size_t CEEngine::estimateBufferBytes(const EngineConfig &config)
+{
+    // The reader batch, the values of one column while the synopses are built with the points the CDF model is fit
+    // to, and the selection masks of a query.
+    size_t capacity = (size_t)std::max(0, config.sampleCapacity);
+    return (size_t)std::max(0, config.readerCacheBytes) + 3 * capacity * sizeof(int) + 2 * capacity / 8;
+}
+
+/**
+ * Shrink one of the sizes of a configuration a step.
+ * @param config Configuration shrunk.
+ * @param step Size shrunk, the ones cheapest to lose first.
+ * @return return false if that size cannot get any smaller.
+ */
+static bool shrinkConfig(EngineConfig &config, int step)
+{
+    switch (step) {
+        case 0:
+            if (config.cacheEntries <= 128)
+                return false;
+            config.cacheEntries /= 2;
+            return true;
+        case 1:
+            if (config.gridColumns <= 0)
+                return false;
+            if (config.gridCells > 8)
+                config.gridCells /= 2;
+            else
+                config.gridColumns = 0;
+            return true;
+        case 2:
+            if (!config.cdfModel)
+                return false;
+            if (config.cdfMaxKnots > 256)
+                config.cdfMaxKnots /= 2;
+            else
+                config.cdfModel = false;
+            return true;
+        case 3:
+            if (config.sketchWidth <= 256)
+                return false;
+            config.sketchWidth /= 2;
+            return true;
+        case 4:
+            if (config.histogramBuckets <= 32)
+                return false;
+            config.histogramBuckets /= 2;
+            return true;
+        case 5:
+            if (config.readerCacheBytes <= 64 * 1024)
+                return false;
+            config.readerCacheBytes /= 2;
+            return true;
+        case 6:
+            if (config.sampleCapacity <= 1024)
+                return false;
+            config.sampleCapacity /= 2;
+            return true;
+        case 7:
+            if (config.sketchDepth <= 2)
+                return false;
+            config.sketchDepth--;
+            return true;
+        default:
+            return false;
+    }
+}
+
+EngineConfig CEEngine::budgetConfig(int num, const std::vector<ColumnPlan> &plans, const EngineConfig &config)
+{
+    static const int SHRINK_STEPS = 8;
+    EngineConfig sized = config;
+    auto fits = [&](const EngineConfig &candidate) {
+        return estimateArenaBytes(num, plans, candidate) + estimateBufferBytes(candidate) <= config.memoryBudget;
+    };
+    // The sizes are shrunk in turn rather than one to its minimum, so every synopsis keeps part of its accuracy. A
+    // budget too small for the smallest sizes leaves them all at their minimum.
+    int stuck = 0;
+    for (int step = 0; stuck < SHRINK_STEPS && !fits(sized); step = (step + 1) % SHRINK_STEPS)
+        stuck = shrinkConfig(sized, step) ? 0 : stuck + 1;
+    // The sample capacity is meant for 4-byte columns. The room left under the budget goes to more slots, up to the
+    // bytes the packed columns save and to the size of the table.
+    size_t rawSlot = 4 * plans.size() + 4 + 4;
+    size_t packedSlot = codeBytes(plans) + 4 + 4;
+    long long low = sized.sampleCapacity;
+    long long high = std::min<long long>(num, (long long)sized.sampleCapacity * rawSlot / packedSlot);
+    while (low < high && fits(sized)) {
+        EngineConfig raised = sized;
+        raised.sampleCapacity = (int)((low + high + 1) / 2);
+        if (fits(raised))
+            low = raised.sampleCapacity;
+        else
+            high = raised.sampleCapacity - 1;
+    }
+    sized.sampleCapacity = (int)low;
+    return sized;
+}
+
+void CEEngine::ensureColumns(int columns)
+{
+    summaries.resize(columns);
+    columnEpochs.resize(columns, 0);
+    columnVersions.resize(columns, 0);
+    equalHits.resize(columns, 0);
+    rangeHits.resize(columns, 0);
+    bucketTargets.resize(columns, 0);
+    widthTargets.resize(columns, 0);
+    size_t staged = (size_t)std::max(1, config.stagingCapacity);
+    stagedValues.reserve(staged * columns);
+    stagedIds.reserve(staged);
+    stagedDeletes.reserve(staged);
+}
+
+void CEEngine::buildSynopses()
+{
+    const SampleStore &store = reservoir.getStore();
+    int columns = store.columnCount();
+    if (columns > 0)
+        ensureColumns(columns);
+    for (int c = 0; c < columns; ++c)
+        columnVersions[c]++;
+    columnEstimators.reset(columns);
+    refitColumn = -1;
+    grids.clear();
+    gridOf.assign(columns * columns, -1);
+    drift.init(columns, bucketLimit(config), &arena);
+    if (store.size() == 0)
+        return;
+    double scale = (double)reservoir.getPopulation() / store.size();
+    std::vector<int> values;
+    for (int c = 0; c < store.columnCount(); ++c) {
+        store.columnValues(c, values);
+        std::sort(values.begin(), values.end());
+        columnEstimators.build(c, values, scale, config, rng, &arena);
+    }
+    int gridColumns = std::min(columns, config.gridColumns);
+    grids.reserve(gridColumns * (gridColumns - 1) / 2);
+    std::vector<int> other;
+    for (int a = 0; a < gridColumns; ++a) {
+        store.columnValues(a, values);
+        for (int b = a + 1; b < gridColumns; ++b) {
+            store.columnValues(b, other);
+            gridOf[a * columns + b] = (int)grids.size();
+            grids.push_back(GridHistogram());
+            grids.back().build(a, b, values, other, scale, config.gridCells, &arena);
+        }
+    }
+}
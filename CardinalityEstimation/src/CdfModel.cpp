@@ -0,0 +1,337 @@
+//
+// Piecewise-linear CDF model of one column, used for range selectivity on smooth distributions.
+//
+
+#include <estimator/CdfModel.h>
+
+CdfModel::CdfModel()
+{
+    this->origin = 0;
+    this->shift = 0;
+    this->baseTotal = 0;
+    this->pendingSum = 0;
+    this->dirty = false;
+    this->changes = 0;
+    this->refitting = false;
+    this->stratum = 0;
+    this->cursor = 0;
+    this->lowestSeen = INT32_MAX;
+    this->highestSeen = INT32_MIN;
+}
+
+size_t CdfModel::arenaBytes(const EngineConfig &config)
+{
+    // Knots, radix table and correction bins.
+    if (!config.cdfModel)
+        return 0;
+    return (size_t)std::max(0, config.cdfMaxKnots) * (sizeof(int) + 2 * sizeof(double)) +
+           (((size_t)1 << std::max(1, std::min(config.cdfRadixBits, 24))) + 2) * sizeof(int) +
+           (2 * CORRECTION_BINS + 1) * sizeof(double);
+}
+
+bool CdfModel::fit(const std::vector<int> &values, double scale, double error, int maxKnots, int radixBits,
+                   Arena *arena)
+{
+    knotX = ArenaVector<int>(ArenaAllocator<int>(arena));
+    knotY = ArenaVector<double>(ArenaAllocator<double>(arena));
+    radix = ArenaVector<int>(ArenaAllocator<int>(arena));
+    folded = ArenaVector<double>(CORRECTION_BINS + 1, 0.0, ArenaAllocator<double>(arena));
+    pending = ArenaVector<double>(CORRECTION_BINS, 0.0, ArenaAllocator<double>(arena));
+    hits = ArenaVector<double>(ArenaAllocator<double>(arena));
+    pendingSum = 0;
+    dirty = false;
+    changes = 0;
+    refitting = false;
+    int n = (int)values.size();
+    baseTotal = n * scale;
+    // One point per distinct value, at the number of sampled values not above it.
+    std::vector<int> xs;
+    std::vector<int> ys;
+    for (int i = 0; i < n; ++i) {
+        if (i + 1 == n || values[i + 1] != values[i]) {
+            xs.push_back(values[i]);
+            ys.push_back(i + 1);
+        }
+    }
+    int points = (int)xs.size();
+    if (points < 2 || maxKnots < 2)
+        return false;
+    // Greedy spline corridor: the slopes from the last knot that keep every point since within its bound of the line
+    // narrow down, and the previous point becomes a knot once a point falls outside them. The bound of a point is a
+    // share of the sampled values on its nearer side, and never below their sampling noise, so the tails, where a
+    // GREATER estimate is small, are followed closely and the middle is not fit to noise.
+    auto bound = [&](int i) {
+        double side = std::min(ys[i], n - ys[i]);
+        return std::max(1.0, std::max(error * side, std::sqrt(side)));
+    };
+    std::vector<int> knots(1, 0);
+    int base = 0;
+    double up = INFINITY;
+    double down = -INFINITY;
+    for (int i = 1; i < points; ++i) {
+        double dx = (double)xs[i] - xs[base];
+        double slope = (ys[i] - ys[base]) / dx;
+        if (slope > up || slope < down) {
+            base = i - 1;
+            knots.push_back(base);
+            if ((int)knots.size() >= maxKnots)
+                return false;
+            dx = (double)xs[i] - xs[base];
+            up = INFINITY;
+            down = -INFINITY;
+        }
+        double eps = bound(i);
+        up = std::min(up, (ys[i] + eps - ys[base]) / dx);
+        down = std::max(down, (ys[i] - eps - ys[base]) / dx);
+    }
+    knots.push_back(points - 1);
+    knotX.reserve(knots.size());
+    knotY.reserve(knots.size());
+    for (int k = 0; k < (int)knots.size(); ++k) {
+        knotX.push_back(xs[knots[k]]);
+        knotY.push_back((double)ys[knots[k]] / n);
+    }
+    hits.reserve(knots.size() + 1);
+    buildRadix(radixBits);
+    return true;
+}
+
+void CdfModel::buildRadix(int radixBits)
+{
+    origin = knotX[0];
+    long long range = (long long)knotX.back() - origin;
+    int bits = 0;
+    while (bits < 40 && (range >> bits) != 0)
+        bits++;
+    shift = std::max(0, bits - std::max(1, std::min(radixBits, 24)));
+    int prefixes = (int)(range >> shift) + 1;
+    radix.assign(prefixes + 1, (int)knotX.size());
+    for (int k = (int)knotX.size() - 1; k >= 0; --k)
+        radix[((long long)knotX[k] - origin) >> shift] = k;
+    for (int p = prefixes - 1; p >= 0; --p)
+        radix[p] = std::min(radix[p], radix[p + 1]);
+}
+
+double CdfModel::fraction(int value) const
+{
+    if (value < knotX[0])
+        return 0;
+    if (value >= knotX.back())
+        return 1;
+    // Updates may have moved the outer knots past the radix table, which is why the prefix is clamped.
+    long long p = std::max(0LL, ((long long)value - origin) >> shift);
+    p = std::min(p, (long long)radix.size() - 2);
+    const int *first = knotX.data() + radix[p];
+    const int *last = knotX.data() + radix[p + 1];
+    int k = (int)(std::upper_bound(first, last, value) - knotX.data()) - 1;
+    double x0 = knotX[k];
+    double x1 = knotX[k + 1];
+    return knotY[k] + (knotY[k + 1] - knotY[k]) * ((double)value - x0) / (x1 - x0);
+}
+
+int CdfModel::binOf(double share) const
+{
+    return std::min(CORRECTION_BINS - 1, std::max(0, (int)(share * CORRECTION_BINS)));
+}
+
+void CdfModel::update(int value, double delta)
+{
+    if (!usable())
+        return;
+    if (value < knotX[0])
+        knotX[0] = value;
+    if (value > knotX.back())
+        knotX.back() = value;
+    int bin = binOf(fraction(value));
+    pending[bin] += delta;
+    pendingSum += delta;
+    dirty = true;
+    changes++;
+}
+
+void CdfModel::fold()
+{
+    double running = 0;
+    double previous = folded[0];
+    for (int b = 0; b < CORRECTION_BINS; ++b) {
+        double bin = folded[b + 1] - previous;
+        previous = folded[b + 1];
+        running += bin + pending[b];
+        folded[b + 1] = running;
+        pending[b] = 0;
+    }
+    pendingSum = 0;
+    dirty = false;
+}
+
+double CdfModel::greater(int value) const
+{
+    return usable() ? greaterAt(fraction(value)) : 0;
+}
+
+bool CdfModel::estimate(const ColumnRange &range, double, double &rows) const
+{
+    if (range.isPoint() || !usable())
+        return false;
+    double above = range.from <= INT32_MIN ? getTotal() : greater((int)(range.from - 1));
+    rows = above - greater((int)range.to);
+    return true;
+}
+
+bool CdfModel::estimateSorted(const int *values, int count, double *out) const
+{
+    if (!usable())
+        return false;
+    greaterSorted(values, count, out);
+    return true;
+}
+
+void CdfModel::greaterSorted(const int *values, int count, double *out) const
+{
+    int k = 0;
+    for (int i = 0; i < count && usable(); ++i) {
+        int value = values[i];
+        double share = 1;
+        if (value < knotX[0]) {
+            share = 0;
+        } else if (value < knotX.back()) {
+            while (knotX[k + 1] <= value)
+                k++;
+            double x0 = knotX[k];
+            double x1 = knotX[k + 1];
+            share = knotY[k] + (knotY[k + 1] - knotY[k]) * ((double)value - x0) / (x1 - x0);
+        }
+        out[i] = greaterAt(share);
+    }
+}
+
+double CdfModel::greaterAt(double share) const
+{
+    int bin = binOf(share);
+    // Corrections of a bin are spread over it like the modelled rows.
+    double inside = std::min(1.0, std::max(0.0, share * CORRECTION_BINS - bin));
+    double correction = folded[bin + 1] - folded[bin] + pending[bin];
+    double total = getTotal();
+    double below = baseTotal * share + folded[bin] + correction * inside;
+    return std::min(total, std::max(0.0, total - below));
+}
+
+void CdfModel::startRefit()
+{
+    hits.assign(knotX.size() + 1, 0.0);
+    refitting = true;
+    stratum = 0;
+    cursor = 0;
+    lowestSeen = INT32_MAX;
+    highestSeen = INT32_MIN;
+}
+
+bool CdfModel::scan(const SampleStore &store, int column, double weight, int words)
+{
+    int32_t values[64];
+    const uint64_t *live = store.liveWords();
+    const int *first = knotX.data();
+    int count = (int)knotX.size();
+    int last = std::min(store.usedWords(), cursor + std::max(1, words));
+    for (int w = cursor; w < last && store.initialized(); ++w) {
+        if (live[w] == 0)
+            continue;
+        store.decodeWord(column, w, values);
+        for (uint64_t bits = live[w]; bits != 0; bits &= bits - 1) {
+            int value = values[__builtin_ctzll(bits)];
+            // Branch-free lower bound, as in DriftMonitor::scan.
+            const int *base = first;
+            for (int n = count; n > 1; n -= n >> 1)
+                base = base[(n >> 1) - 1] < value ? base + (n >> 1) : base;
+            hits[(int)(base - first) + (*base < value)] += weight;
+            lowestSeen = std::min(lowestSeen, value);
+            highestSeen = std::max(highestSeen, value);
+        }
+    }
+    cursor = last;
+    if (cursor < store.usedWords())
+        return false;
+    stratum++;
+    cursor = 0;
+    return true;
+}
+
+void CdfModel::finishRefit()
+{
+    refitting = false;
+    int knots = (int)knotX.size();
+    double sampled = 0;
+    for (int k = 0; k <= knots; ++k)
+        sampled += hits[k];
+    if (sampled <= 0)
+        return;
+    if (lowestSeen < knotX[0])
+        knotX[0] = lowestSeen;
+    if (highestSeen > knotX.back()) {
+        knotX.back() = highestSeen;
+        hits[knots - 1] += hits[knots];
+    }
+    double below = 0;
+    for (int k = 0; k < knots; ++k) {
+        below += hits[k];
+        knotY[k] = std::min(1.0, below / sampled);
+    }
+    knotY.back() = 1;
+    // The counters are exact where the sample is not, so the recounted knots describe the current total.
+    baseTotal = std::max(0.0, getTotal());
+    std::fill(folded.begin(), folded.end(), 0.0);
+    std::fill(pending.begin(), pending.end(), 0.0);
+    pendingSum = 0;
+    dirty = false;
+    changes = 0;
+}
+
+void CdfModel::save(SnapshotWriter &out) const
+{
+    out.put(origin);
+    out.put(shift);
+    out.put(baseTotal);
+    out.put(pendingSum);
+    out.put(dirty);
+    out.put(changes);
+    out.putVector(knotX);
+    out.putVector(knotY);
+    out.putVector(radix);
+    out.putVector(folded);
+    out.putVector(pending);
+}
+
+bool CdfModel::load(SnapshotReader &in, Arena *arena)
+{
+    knotX = ArenaVector<int>(ArenaAllocator<int>(arena));
+    knotY = ArenaVector<double>(ArenaAllocator<double>(arena));
+    radix = ArenaVector<int>(ArenaAllocator<int>(arena));
+    folded = ArenaVector<double>(ArenaAllocator<double>(arena));
+    pending = ArenaVector<double>(ArenaAllocator<double>(arena));
+    hits = ArenaVector<double>(ArenaAllocator<double>(arena));
+    refitting = false;
+    in.get(origin);
+    in.get(shift);
+    in.get(baseTotal);
+    in.get(pendingSum);
+    in.get(dirty);
+    in.get(changes);
+    in.getVector(knotX);
+    in.getVector(knotY);
+    in.getVector(radix);
+    in.getVector(folded);
+    in.getVector(pending);
+    if (!in.ok() || knotX.size() != knotY.size() || shift < 0 || shift > 40)
+        return false;
+    if (knotX.empty())
+        return radix.empty();
+    if (folded.size() != CORRECTION_BINS + 1 || pending.size() != CORRECTION_BINS || radix.size() < 2 ||
+        radix.back() != (int)knotX.size())
+        return false;
+    for (int p = 0; p < (int)radix.size(); ++p) {
+        if (radix[p] < 0 || radix[p] > (int)knotX.size() || (p > 0 && radix[p] < radix[p - 1]))
+            return false;
+    }
+    hits.reserve(knotX.size() + 1);
+    return true;
+}
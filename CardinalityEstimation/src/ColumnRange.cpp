@@ -0,0 +1,32 @@
+//
+// Reduction of a conjunction of predicates to one value range per column.
+//
+
+#include <estimator/ColumnRange.h>
+
+bool reduceQuals(const std::vector<CompareExpression> &quals, std::vector<ColumnRange> &ranges)
+{
+    ranges.clear();
+    for (int j = 0; j < (int)quals.size(); ++j) {
+        const CompareExpression &expr = quals[j];
+        int k = 0;
+        while (k < (int)ranges.size() && ranges[k].column != expr.columnIdx)
+            k++;
+        if (k == (int)ranges.size())
+            ranges.push_back({expr.columnIdx, (long long)INT32_MIN, (long long)INT32_MAX});
+        ColumnRange &range = ranges[k];
+        if (expr.compareOp == GREATER) {
+            range.from = std::max(range.from, (long long)expr.value + 1);
+        } else {
+            range.from = std::max(range.from, (long long)expr.value);
+            range.to = std::min(range.to, (long long)expr.value);
+        }
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const ColumnRange &x, const ColumnRange &y) { return x.column < y.column; });
+    for (int k = 0; k < (int)ranges.size(); ++k) {
+        if (ranges[k].isEmpty())
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+//
+// Per-column summary statistics.
+//
+
+#include <estimator/ColumnSummary.h>
+
+double estimateDistinct(std::vector<int> &values, long long population)
+{
+    long long n = (long long)values.size();
+    if (n == 0)
+        return 1;
+    std::sort(values.begin(), values.end());
+    // frequencies[i] is the number of values seen exactly i times.
+    std::vector<long long> frequencies(1, 0);
+    long long distinct = 0;
+    for (long long i = 0; i < n;) {
+        long long j = i;
+        while (j < n && values[j] == values[i])
+            j++;
+        if ((long long)frequencies.size() <= j - i)
+            frequencies.resize(j - i + 1, 0);
+        frequencies[j - i]++;
+        distinct++;
+        i = j;
+    }
+    if (population <= n || frequencies.size() < 2 || frequencies[1] == 0)
+        return (double)distinct;
+    double q = (double)n / population;
+    double numerator = 0;
+    double denominator = 0;
+    double power = 1;
+    for (int i = 1; i < (int)frequencies.size(); ++i) {
+        numerator += power * (1 - q) * frequencies[i];
+        denominator += i * q * power * frequencies[i];
+        power *= 1 - q;
+    }
+    double ndv = distinct + frequencies[1] * numerator / std::max(denominator, 1e-12);
+    return std::max(1.0, std::min(ndv, (double)population));
+}
@@ -1,97 +1,317 @@
-//
-// Demo data generator for local debugging. You can implement your own data generator for debugging based on this class.
-//
-
-#include <executer/DataExecuterDemo.h>
-
-std::unordered_map<int, bool> vis;
-DataExecuterDemo::DataExecuterDemo(int end, int count) : DataExecuter()
-{
-    this->end = end;
-    this->count = count;
-    for (int i = 0; i <= end; ++i) {
-        std::vector<int> tuple;
-        tuple.push_back(rand());
-        tuple.push_back(rand());
-        set.push_back(tuple);
-    }
-}
-
-std::vector<int> DataExecuterDemo::generateInsert()
-{
-    std::vector<int> tuple;
-    tuple.push_back(rand());
-    tuple.push_back(rand());
-    set.push_back(tuple);
-    end++;
-    return tuple;
-}
-
-int DataExecuterDemo::generateDelete()
-{
-    int x = (rand()) % end;
-    while (vis[x]) {
-        x = (rand()) % end;
-    }
-    vis[x] = true;
-    return x;
-}
-
-void DataExecuterDemo::readTuples(int start, int offset, std::vector<std::vector<int>> &vec)
-{
-    for (int i = start; i < start + offset; ++i) {
-        if (!vis[i]) {
-            vec.push_back(set[i]);
-        }
-    }
-    return;
-};
-
-Action DataExecuterDemo::getNextAction()
-{
-    Action action;
-    if (count == 0) {
-        action.actionType = NONE;
-        return action;
-    }
-    if (count % 100 == 99) {
-        action.actionType = QUERY;
-        CompareExpression expr = {rand() % 2, CompareOp(rand() % 2), rand()};
-        action.quals.push_back(expr);
-    } else if (count % 100 < 90) {
-        action.actionType = INSERT;
-        action.actionTuple = generateInsert();
-    } else {
-        action.actionType = DELETE;
-        action.tupleId = generateDelete();
-        action.actionTuple = set[action.tupleId];
-    }
-    count--;
-    curAction = action;
-    return action;
-};
-
-double DataExecuterDemo::answer(int ans)
-{
-    int cnt = 0;
-    for (int i = 0; i <= end; ++i) {
-        if (vis[i])
-            continue;
-        bool flag = true;
-        for (int j = 0; j < curAction.quals.size(); ++j) {
-            CompareExpression &expr = curAction.quals[j];
-            if (expr.compareOp == GREATER && set[i][expr.columnIdx] <= expr.value) {
-                flag = false;
-                break;
-            }
-            if (expr.compareOp == EQUAL && set[i][expr.columnIdx] != expr.value) {
-                flag = false;
-                break;
-            }
-        }
-        if (flag)
-            cnt++;
-    }
-    double error = fabs(std::log((ans + 1) * 1.0 / (cnt + 1)));
-    return error;
-};
+//
+// Demo data generator for local debugging. You can implement your own data generator for debugging based on this class.
+//
+
+#include <executer/DataExecuterDemo.h>
+
+DataExecuterDemo::DataExecuterDemo(int end, int count) : DataExecuterDemo(end, count, DemoConfig())
+{
+}
+
+DataExecuterDemo::DataExecuterDemo(int end, int count, const DemoConfig &config)
+    : DataExecuter(), random(config.seed)
+{
+    this->count = count;
+    this->config = config;
+    this->valid = true;
+    int maxValue = config.domain > 0 ? config.domain - 1 : RAND_MAX;
+    for (int c = 0; c < config.columns; ++c) {
+        ColumnSpec spec = c < (int)config.specs.size() ? config.specs[c] : ColumnSpec();
+        if (spec.source >= c)
+            spec.source = -1;
+        generators.push_back(makeGenerator(spec, maxValue, (long long)end + 1 + count, &random));
+    }
+    initStorage(end + 1, 0, maxValue);
+    for (int i = 0; i <= end; ++i) {
+        int *tuple = data.data() + (size_t)i * config.columns;
+        generateTuple(i, tuple);
+        for (int c = 0; c < config.columns; ++c)
+            oracles[c].load(tuple[c]);
+    }
+    for (int c = 0; c < config.columns; ++c)
+        oracles[c].build();
+}
+
+DataExecuterDemo::DataExecuterDemo(const std::string &tracePath)
+    : DataExecuter(), random(DemoConfig().seed), replay(tracePath)
+{
+    std::string magic;
+    int columns = 0;
+    int tuples = 0;
+    this->count = 0;
+    this->valid = replay >> magic >> columns >> tuples >> count && magic == "trace" && columns > 0 && tuples >= 0;
+    config.columns = std::max(columns, 1);
+    // Recorded values may span the whole int range.
+    initStorage(valid ? tuples : 0, INT32_MIN, INT32_MAX);
+    for (size_t k = 0; k < data.size() && valid; ++k) {
+        valid = (bool)(replay >> data[k]);
+        oracles[k % config.columns].load(data[k]);
+    }
+    for (int c = 0; c < config.columns; ++c)
+        oracles[c].build();
+    if (!valid)
+        count = 0;
+}
+
+void DataExecuterDemo::initStorage(int tuples, long long minValue, long long maxValue)
+{
+    this->end = tuples - 1;
+    this->tuplesRead = 0;
+    data.assign((size_t)tuples * config.columns, 0);
+    deleted.assign(((size_t)std::max(tuples, 1) >> 6) + 1, 0);
+    oracles.resize(config.columns);
+    for (int c = 0; c < config.columns; ++c)
+        oracles[c].init(minValue, maxValue);
+}
+
+void DataExecuterDemo::appendTuple(const int *tuple)
+{
+    for (int c = 0; c < config.columns; ++c)
+        oracles[c].insert(tuple[c]);
+    data.insert(data.end(), tuple, tuple + config.columns);
+    end++;
+    if (deleted.size() <= ((size_t)end >> 6))
+        deleted.push_back(0);
+}
+
+void DataExecuterDemo::removeTuple(int tupleId)
+{
+    deleted[tupleId >> 6] |= 1ULL << (tupleId & 63);
+    const int *tuple = row(tupleId);
+    for (int c = 0; c < config.columns; ++c)
+        oracles[c].remove(tuple[c]);
+}
+
+void DataExecuterDemo::generateTuple(long long index, int *tuple)
+{
+    for (int c = 0; c < config.columns; ++c)
+        tuple[c] = generators[c]->next(index, tuple);
+}
+
+CompareExpression DataExecuterDemo::generatePredicate()
+{
+    CompareExpression expr;
+    expr.columnIdx = random.next() % config.columns;
+    if (config.equalPredicates && config.greaterPredicates)
+        expr.compareOp = CompareOp(random.next() % 2);
+    else
+        expr.compareOp = config.equalPredicates ? EQUAL : GREATER;
+    expr.value = generators[expr.columnIdx]->next(end + 1, nullptr);
+    return expr;
+}
+
+void DataExecuterDemo::generateInsert(std::vector<int> &tuple)
+{
+    tuple.resize(config.columns);
+    generateTuple(end + 1, tuple.data());
+    appendTuple(tuple.data());
+}
+
+int DataExecuterDemo::generateDelete()
+{
+    int x = random.next() % end;
+    while (isDeleted(x)) {
+        x = random.next() % end;
+    }
+    removeTuple(x);
+    return x;
+}
+
+bool DataExecuterDemo::replayAction(Action &action)
+{
+    char type;
+    if (!(replay >> type))
+        return false;
+    if (type == 'I') {
+        action.actionType = INSERT;
+        action.actionTuple.resize(config.columns);
+        for (int c = 0; c < config.columns; ++c) {
+            if (!(replay >> action.actionTuple[c]))
+                return false;
+        }
+        appendTuple(action.actionTuple.data());
+    } else if (type == 'D') {
+        action.actionType = DELETE;
+        if (!(replay >> action.tupleId) || action.tupleId < 0 || action.tupleId > end || isDeleted(action.tupleId))
+            return false;
+        action.actionTuple.assign(row(action.tupleId), row(action.tupleId) + config.columns);
+        removeTuple(action.tupleId);
+    } else if (type == 'Q') {
+        action.actionType = QUERY;
+        int predicates = 0;
+        if (!(replay >> predicates) || predicates < 0)
+            return false;
+        for (int j = 0; j < predicates; ++j) {
+            CompareExpression expr;
+            int op;
+            if (!(replay >> expr.columnIdx >> op >> expr.value) || op < EQUAL || op > GREATER ||
+                expr.columnIdx < 0 || expr.columnIdx >= config.columns)
+                return false;
+            expr.compareOp = CompareOp(op);
+            action.quals.push_back(expr);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool DataExecuterDemo::startRecording(const std::string &tracePath)
+{
+    recording.open(tracePath);
+    if (!recording)
+        return false;
+    recording << "trace " << config.columns << " " << end + 1 << " " << count << "\n";
+    for (int i = 0; i <= end; ++i) {
+        const int *tuple = row(i);
+        for (int c = 0; c < config.columns; ++c)
+            recording << (c == 0 ? "" : " ") << tuple[c];
+        recording << "\n";
+    }
+    return (bool)recording;
+}
+
+void DataExecuterDemo::recordAction(const Action &action)
+{
+    if (action.actionType == INSERT) {
+        recording << "I";
+        for (int c = 0; c < (int)action.actionTuple.size(); ++c)
+            recording << " " << action.actionTuple[c];
+    } else if (action.actionType == DELETE) {
+        recording << "D " << action.tupleId;
+    } else if (action.actionType == QUERY) {
+        recording << "Q " << action.quals.size();
+        for (int j = 0; j < (int)action.quals.size(); ++j) {
+            const CompareExpression &expr = action.quals[j];
+            recording << " " << expr.columnIdx << " " << (int)expr.compareOp << " " << expr.value;
+        }
+    }
+    recording << "\n";
+}
+
+uint64_t DataExecuterDemo::liveWord(int word) const
+{
+    uint64_t live = ~deleted[word];
+    long long last = (long long)end + 1 - ((long long)word << 6);
+    return last < 64 ? live & ((1ULL << last) - 1) : live;
+}
+
+void DataExecuterDemo::readTuples(int start, int offset, std::vector<std::vector<int>> &vec)
+{
+    long long from = std::max(start, 0);
+    long long to = std::min((long long)start + offset, (long long)end + 1);
+    // Walk the deletion bitmap a word at a time; a word without deletions is copied as one contiguous run.
+    for (long long w = from >> 6; w << 6 < to; ++w) {
+        uint64_t live = liveWord((int)w);
+        if ((w << 6) < from)
+            live &= ~0ULL << (from - (w << 6));
+        if (to - (w << 6) < 64)
+            live &= (1ULL << (to - (w << 6))) - 1;
+        if (live == 0)
+            continue;
+        uint64_t run = live >> __builtin_ctzll(live);
+        if ((run & (run + 1)) == 0) {
+            int first = (int)(w << 6) + __builtin_ctzll(live);
+            int last = first + __builtin_popcountll(live);
+            for (int i = first; i < last; ++i)
+                vec.emplace_back(row(i), row(i) + config.columns);
+            tuplesRead += last - first;
+            continue;
+        }
+        for (; live != 0; live &= live - 1) {
+            int i = (int)(w << 6) + __builtin_ctzll(live);
+            vec.emplace_back(row(i), row(i) + config.columns);
+            tuplesRead++;
+        }
+    }
+};
+
+Action DataExecuterDemo::getNextAction()
+{
+    Action action;
+    getNextAction(action);
+    return action;
+}
+
+bool DataExecuterDemo::getNextAction(Action &action)
+{
+    action.actionType = NONE;
+    action.quals.clear();
+    if (count == 0)
+        return false;
+    if (replay.is_open()) {
+        if (!replayAction(action)) {
+            valid = false;
+            count = 0;
+            action.actionType = NONE;
+            action.actionTuple.clear();
+            action.quals.clear();
+            return false;
+        }
+    } else if (count % 100 >= config.insertPercent + config.deletePercent) {
+        action.actionType = QUERY;
+        int predicates = config.minPredicates;
+        if (config.maxPredicates > config.minPredicates)
+            predicates += random.next() % (config.maxPredicates - config.minPredicates + 1);
+        for (int j = 0; j < predicates; ++j)
+            action.quals.push_back(generatePredicate());
+    } else if (count % 100 < config.insertPercent) {
+        action.actionType = INSERT;
+        generateInsert(action.actionTuple);
+    } else {
+        action.actionType = DELETE;
+        action.tupleId = generateDelete();
+        action.actionTuple.assign(row(action.tupleId), row(action.tupleId) + config.columns);
+    }
+    if (recording.is_open())
+        recordAction(action);
+    count--;
+    // Only a query is answered later; assigning reuses the buffer of the last one.
+    if (action.actionType == QUERY)
+        lastQuals = action.quals;
+    return true;
+}
+
+long long DataExecuterDemo::countMatches(const std::vector<CompareExpression> &quals) const
+{
+    if (quals.empty())
+        return oracles.empty() ? 0 : oracles[0].size();
+    // Predicates on a single column reduce to one value range, answered by the oracle of the column.
+    long long from = INT32_MIN;
+    long long to = INT32_MAX;
+    bool singleColumn = true;
+    for (int j = 0; j < (int)quals.size(); ++j) {
+        const CompareExpression &expr = quals[j];
+        singleColumn = singleColumn && expr.columnIdx == quals[0].columnIdx;
+        if (expr.compareOp == GREATER) {
+            from = std::max(from, (long long)expr.value + 1);
+        } else {
+            from = std::max(from, (long long)expr.value);
+            to = std::min(to, (long long)expr.value);
+        }
+    }
+    if (singleColumn)
+        return oracles[quals[0].columnIdx].range(from, to);
+    // Otherwise scan the live tuples, skipping deleted ones a bitmap word at a time.
+    long long cnt = 0;
+    for (int w = 0; w < (int)deleted.size(); ++w) {
+        for (uint64_t live = liveWord(w); live != 0; live &= live - 1) {
+            const int *tuple = row((w << 6) + __builtin_ctzll(live));
+            bool flag = true;
+            for (int j = 0; j < (int)quals.size() && flag; ++j) {
+                const CompareExpression &expr = quals[j];
+                int value = tuple[expr.columnIdx];
+                flag = expr.compareOp == GREATER ? value > expr.value : value == expr.value;
+            }
+            cnt += flag;
+        }
+    }
+    return cnt;
+}
+
+double DataExecuterDemo::answer(int ans)
+{
+    long long cnt = countMatches(lastQuals);
+    double error = fabs(std::log((ans + 1) * 1.0 / (cnt + 1)));
+    return error;
+};
@@ -0,0 +1,105 @@
+//
+// Exact per-column counts used by the demo generator to answer queries.
+//
+
+#include <executer/DemoOracle.h>
+
+ColumnOracle::ColumnOracle()
+{
+    this->minValue = 0;
+    this->maxValue = 0;
+    this->width = 1;
+    this->buckets = 0;
+    this->total = 0;
+}
+
+void ColumnOracle::init(long long minValue, long long maxValue)
+{
+    this->minValue = minValue;
+    this->maxValue = maxValue;
+    long long domain = maxValue - minValue + 1;
+    this->width = (domain + MAX_BUCKETS - 1) / MAX_BUCKETS;
+    this->buckets = (int)((domain + width - 1) / width);
+    this->total = 0;
+    counts.assign(buckets, 0);
+    tree.assign(buckets + 1, 0);
+    values.assign(width > 1 ? buckets : 0, std::vector<int>());
+}
+
+long long ColumnOracle::prefix(int bucket) const
+{
+    long long sum = 0;
+    for (int i = bucket; i > 0; i -= i & -i)
+        sum += tree[i];
+    return sum;
+}
+
+void ColumnOracle::add(int bucket, long long delta)
+{
+    counts[bucket] += delta;
+    total += delta;
+    for (int i = bucket + 1; i <= buckets; i += i & -i)
+        tree[i] += delta;
+}
+
+void ColumnOracle::load(int value)
+{
+    int bucket = bucketOf(value);
+    counts[bucket]++;
+    total++;
+    if (width > 1)
+        values[bucket].push_back(value);
+}
+
+void ColumnOracle::build()
+{
+    for (int b = 0; b < (int)values.size(); ++b)
+        std::sort(values[b].begin(), values[b].end());
+    // Linear Fenwick construction: every node pushes its sum to its parent.
+    for (int i = 1; i <= buckets; ++i)
+        tree[i] = counts[i - 1];
+    for (int i = 1; i <= buckets; ++i) {
+        int parent = i + (i & -i);
+        if (parent <= buckets)
+            tree[parent] += tree[i];
+    }
+}
+
+void ColumnOracle::insert(int value)
+{
+    int bucket = bucketOf(value);
+    add(bucket, 1);
+    if (width > 1) {
+        std::vector<int> &sorted = values[bucket];
+        sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+    }
+}
+
+void ColumnOracle::remove(int value)
+{
+    int bucket = bucketOf(value);
+    add(bucket, -1);
+    if (width > 1) {
+        std::vector<int> &sorted = values[bucket];
+        sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), value));
+    }
+}
+
+long long ColumnOracle::range(long long from, long long to) const
+{
+    from = std::max(from, minValue);
+    to = std::min(to, maxValue);
+    if (from > to)
+        return 0;
+    int first = bucketOf(from);
+    int last = bucketOf(to);
+    long long count = prefix(last + 1) - prefix(first);
+    if (width > 1) {
+        // Drop the values of the boundary buckets that fall outside [from, to].
+        const std::vector<int> &low = values[first];
+        count -= std::lower_bound(low.begin(), low.end(), from) - low.begin();
+        const std::vector<int> &high = values[last];
+        count -= high.end() - std::upper_bound(high.begin(), high.end(), to);
+    }
+    return count;
+}
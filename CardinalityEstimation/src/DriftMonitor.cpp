@@ -0,0 +1,161 @@
+//
+// Drift detection between the reservoir sample and the per-column histograms.
+//
+
+#include <estimator/DriftMonitor.h>
+
+// Sampled values a bucket needs before its spread is trusted enough to split it.
+static const int MIN_BUCKET_SAMPLES = 32;
+
+typedef struct Repair {
+    long long lo;
+    int hi;
+    int at;
+    double share;
+    double error;
+} Repair;
+
+DriftMonitor::DriftMonitor()
+{
+    this->inserts = 0;
+    this->deletes = 0;
+    this->column = -1;
+    this->stratum = 0;
+    this->cursor = 0;
+    this->nextColumn = 0;
+    this->lowest = 0;
+    this->checks = 0;
+    this->repairs = 0;
+}
+
+void DriftMonitor::init(int columns, int buckets, Arena *arena)
+{
+    insertsAt = ArenaVector<long long>(columns, inserts, ArenaAllocator<long long>(arena));
+    deletesAt = ArenaVector<long long>(columns, deletes, ArenaAllocator<long long>(arena));
+    distances = ArenaVector<double>(columns, 0.0, ArenaAllocator<double>(arena));
+    // A split may leave a histogram one bucket wider than it was built.
+    points = ArenaVector<int>(ArenaAllocator<int>(arena));
+    hits = ArenaVector<double>(ArenaAllocator<double>(arena));
+    samples = ArenaVector<int>(ArenaAllocator<int>(arena));
+    points.reserve(2 * (size_t)buckets + 2);
+    hits.reserve(2 * (size_t)buckets + 3);
+    samples.reserve(2 * (size_t)buckets + 3);
+    column = -1;
+}
+
+int DriftMonitor::due(long long minChanges) const
+{
+    int columns = (int)insertsAt.size();
+    for (int k = 0; k < columns; ++k) {
+        int c = (nextColumn + k) % columns;
+        if (insertsSince(c) + deletesSince(c) >= std::max(1LL, minChanges))
+            return c;
+    }
+    return -1;
+}
+
+void DriftMonitor::start(int column, const EquiDepthHistogram &histogram)
+{
+    this->column = column;
+    this->stratum = 0;
+    this->cursor = 0;
+    this->lowest = histogram.empty() ? 0 : histogram.lowerOf(0);
+    points.clear();
+    for (int b = 0; b < histogram.bucketCount(); ++b) {
+        long long lo = histogram.lowerOf(b);
+        int hi = histogram.upperOf(b);
+        points.push_back(hi - lo >= 2 ? (int)(lo + (hi - lo) / 2) : hi);
+        points.push_back(hi);
+    }
+    hits.assign(points.size() + 1, 0.0);
+    samples.assign(points.size() + 1, 0);
+}
+
+bool DriftMonitor::scan(const SampleStore &store, double weight, int words)
+{
+    int32_t values[64];
+    const uint64_t *live = store.liveWords();
+    const int *first = points.data();
+    int count = (int)points.size();
+    int last = std::min(store.usedWords(), cursor + std::max(1, words));
+    for (int w = cursor; w < last && count > 0 && store.initialized(); ++w) {
+        if (live[w] == 0)
+            continue;
+        store.decodeWord(column, w, values);
+        for (uint64_t bits = live[w]; bits != 0; bits &= bits - 1) {
+            int value = values[__builtin_ctzll(bits)];
+            // Branch-free lower bound: the halving steps compile to conditional moves.
+            const int *base = first;
+            for (int n = count; n > 1; n -= n >> 1)
+                base = base[(n >> 1) - 1] < value ? base + (n >> 1) : base;
+            int point = (int)(base - first) + (*base < value);
+            hits[point] += weight;
+            samples[point]++;
+        }
+    }
+    cursor = last;
+    if (cursor < store.usedWords())
+        return false;
+    stratum++;
+    cursor = 0;
+    return true;
+}
+
+int DriftMonitor::finish(EquiDepthHistogram &histogram, double threshold, int maxRepairs)
+{
+    int c = column;
+    column = -1;
+    checks++;
+    double sampled = 0;
+    for (int i = 0; i < (int)hits.size(); ++i)
+        sampled += hits[i];
+    double total = histogram.getTotal();
+    double distance = 0;
+    double below = 0;
+    for (int i = 0; i < (int)points.size() && sampled > 0 && total > 0; ++i) {
+        below += hits[i];
+        double expected = (total - histogram.greater(points[i])) / total;
+        distance = std::max(distance, std::fabs(below / sampled - expected));
+    }
+    double previous = distances[c];
+    distances[c] = distance;
+    nextColumn = (c + 1) % (int)insertsAt.size();
+    std::vector<Repair> found;
+    int buckets = (int)points.size() / 2;
+    for (int b = 0; b < buckets && distance > threshold && histogram.bucketCount() == buckets; ++b) {
+        long long lo = b == 0 ? lowest : points[2 * b - 1];
+        int hi = points[2 * b + 1];
+        int at = points[2 * b];
+        int inBucket = samples[2 * b] + samples[2 * b + 1];
+        double weight = hits[2 * b] + hits[2 * b + 1];
+        if (inBucket < MIN_BUCKET_SAMPLES || weight <= 0 || at <= lo || at >= hi)
+            continue;
+        // Share of the bucket below its middle, as assumed by the histogram and as seen in the sample; differences
+        // within two standard deviations of the binomial noise are not acted on.
+        double expected = (double)(at - lo) / (double)(hi - lo);
+        double share = hits[2 * b] / weight;
+        double noise = 2 * std::sqrt(expected * (1 - expected) / inBucket);
+        if (std::fabs(share - expected) <= noise)
+            continue;
+        Repair repair = {lo, hi, at, share, std::fabs(share - expected) * histogram.countOf(b)};
+        found.push_back(repair);
+    }
+    std::sort(found.begin(), found.end(), [](const Repair &a, const Repair &b) { return a.error > b.error; });
+    int split = 0;
+    for (int k = 0; k < (int)found.size() && k < maxRepairs; ++k) {
+        // An earlier split merged a pair of buckets and shifted the others, so the bucket is found again by bounds.
+        for (int b = 0; b < histogram.bucketCount(); ++b) {
+            if (histogram.lowerOf(b) == found[k].lo && histogram.upperOf(b) == found[k].hi) {
+                split += histogram.splitBucket(b, found[k].at, found[k].share);
+                break;
+            }
+        }
+    }
+    repairs += split;
+    // A repaired column is checked again right away, as long as every repair brings its histogram and the sample closer.
+    if (split == 0 || (previous > 0 && distance >= previous)) {
+        insertsAt[c] = inserts;
+        deletesAt[c] = deletes;
+    }
+    return split;
+}
@@ -0,0 +1,377 @@
+//
+// Equi-depth histogram of one column, used for range selectivity.
+//
+
+#include <estimator/EquiDepthHistogram.h>
+
+EquiDepthHistogram::EquiDepthHistogram()
+{
+    this->lower = 0;
+    this->total = 0;
+    this->splitThreshold = 2;
+    this->unbalanced = false;
+    this->splits = 0;
+    this->resizeSplits = 0;
+    this->growing = false;
+    this->stratum = 0;
+    this->cursor = 0;
+}
+
+int EquiDepthHistogram::bucketOf(int value) const
+{
+    int bucket = (int)(std::lower_bound(upper.begin(), upper.end(), value) - upper.begin());
+    return std::min(bucket, (int)upper.size() - 1);
+}
+
+void EquiDepthHistogram::add(int bucket, double delta)
+{
+    for (int i = bucket + 1; i <= (int)tree.size(); i += i & -i)
+        tree[i - 1] += delta;
+}
+
+double EquiDepthHistogram::prefix(int buckets) const
+{
+    double sum = 0;
+    for (int i = buckets; i > 0; i -= i & -i)
+        sum += tree[i - 1];
+    return sum;
+}
+
+void EquiDepthHistogram::rebuildTree()
+{
+    tree.assign(counts.size(), 0);
+    for (int i = 1; i <= (int)tree.size(); ++i) {
+        tree[i - 1] += counts[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= (int)tree.size())
+            tree[parent - 1] += tree[i - 1];
+    }
+}
+
+size_t EquiDepthHistogram::arenaBytes(const EngineConfig &config)
+{
+    // Bounds, counts and tree of the buckets, with the spare bucket of a split.
+    return ((size_t)config.histogramBuckets + 1) * (sizeof(int) + 2 * sizeof(double));
+}
+
+void EquiDepthHistogram::build(std::vector<int> &values, double scale, int buckets, double splitThreshold,
+                               Arena *arena)
+{
+    this->splitThreshold = splitThreshold;
+    this->unbalanced = false;
+    this->growing = false;
+    // A split inserts a bucket before merging two others, so one spare bucket avoids any reallocation.
+    upper = ArenaVector<int>(ArenaAllocator<int>(arena));
+    counts = ArenaVector<double>(ArenaAllocator<double>(arena));
+    tree = ArenaVector<double>(ArenaAllocator<double>(arena));
+    upper.reserve(buckets + 1);
+    counts.reserve(buckets + 1);
+    tree.reserve(buckets + 1);
+    total = 0;
+    int n = (int)values.size();
+    if (n == 0 || buckets <= 0) {
+        tree.clear();
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    lower = values[0];
+    double depth = (double)n / buckets;
+    int begin = 0;
+    for (int b = 1; begin < n; ++b) {
+        // Cut after the value at the next depth boundary and its duplicates, so a value never straddles two buckets.
+        int end = std::max(begin + 1, std::min(n, (int)std::llround(b * depth)));
+        while (end < n && values[end] == values[end - 1])
+            end++;
+        upper.push_back(values[end - 1]);
+        counts.push_back((end - begin) * scale);
+        begin = end;
+    }
+    total = n * scale;
+    rebuildTree();
+}
+
+bool EquiDepthHistogram::splitBucket(int bucket, int at, double share)
+{
+    if (bucket < 0 || bucket >= (int)upper.size() || at <= lowerOf(bucket) || at >= upper[bucket] || upper.size() < 2)
+        return false;
+    double first = counts[bucket] * std::min(1.0, std::max(0.0, share));
+    upper.insert(upper.begin() + bucket, at);
+    counts[bucket] -= first;
+    counts.insert(counts.begin() + bucket, first);
+    int merge = -1;
+    for (int i = 0; i + 1 < (int)counts.size(); ++i) {
+        if (i == bucket)
+            continue;
+        if (merge < 0 || counts[i] + counts[i + 1] < counts[merge] + counts[merge + 1])
+            merge = i;
+    }
+    if (merge >= 0) {
+        counts[merge] += counts[merge + 1];
+        counts.erase(counts.begin() + merge + 1);
+        upper.erase(upper.begin() + merge);
+    }
+    splits++;
+    rebuildTree();
+    return true;
+}
+
+bool EquiDepthHistogram::startResize(int buckets, Arena *arena)
+{
+    int n = (int)upper.size();
+    growing = false;
+    if (n == 0 || buckets <= 0 || buckets == n)
+        return false;
+    if (buckets < n) {
+        merge(buckets);
+        return false;
+    }
+    nextUpper = ArenaVector<int>(ArenaAllocator<int>(arena));
+    nextUpper.reserve(buckets + 1);
+    double depth = total / buckets;
+    for (int i = 0; i < n; ++i) {
+        long long lo = lowerOf(i);
+        long long width = upper[i] - lo;
+        // Every bucket keeps at least one part, and none gets more parts than it has values.
+        long long parts = depth > 0 ? std::llround(counts[i] / depth) : 1;
+        parts = std::min(parts, (long long)buckets - (long long)nextUpper.size() - (n - i - 1));
+        parts = std::max(1LL, std::min(parts, width));
+        for (long long k = 1; k < parts; ++k)
+            nextUpper.push_back((int)(lo + width * k / parts));
+        nextUpper.push_back(upper[i]);
+    }
+    nextHits = ArenaVector<double>(nextUpper.size(), 0.0, ArenaAllocator<double>(arena));
+    resizeSplits = splits;
+    growing = true;
+    stratum = 0;
+    cursor = 0;
+    return true;
+}
+
+void EquiDepthHistogram::merge(int buckets)
+{
+    // Buckets are merged up to the next depth boundary, and every bucket is kept once as many are left as new
+    // buckets remain to be made.
+    int n = (int)upper.size();
+    double depth = total / buckets;
+    ArenaVector<int> mergedUpper(upper.get_allocator());
+    ArenaVector<double> mergedCounts(counts.get_allocator());
+    mergedUpper.reserve(buckets + 1);
+    mergedCounts.reserve(buckets + 1);
+    double below = 0;
+    double count = 0;
+    for (int i = 0; i < n; ++i) {
+        below += counts[i];
+        count += counts[i];
+        int made = (int)mergedUpper.size();
+        if (i + 1 == n ||
+            (made + 1 < buckets && (below >= (made + 1) * depth || n - i - 1 <= buckets - made - 1))) {
+            mergedUpper.push_back(upper[i]);
+            mergedCounts.push_back(count);
+            count = 0;
+        }
+    }
+    upper = std::move(mergedUpper);
+    counts = std::move(mergedCounts);
+    tree = ArenaVector<double>(counts.get_allocator());
+    tree.reserve(buckets + 1);
+    splits++;
+    unbalanced = false;
+    rebuildTree();
+}
+
+bool EquiDepthHistogram::scan(const SampleStore &store, int column, double weight, int words)
+{
+    int32_t values[64];
+    const uint64_t *live = store.liveWords();
+    const int *first = nextUpper.data();
+    int count = (int)nextUpper.size();
+    int last = std::min(store.usedWords(), cursor + std::max(1, words));
+    for (int w = cursor; w < last && store.initialized(); ++w) {
+        if (live[w] == 0)
+            continue;
+        store.decodeWord(column, w, values);
+        for (uint64_t bits = live[w]; bits != 0; bits &= bits - 1) {
+            int value = values[__builtin_ctzll(bits)];
+            // Branch-free lower bound, as in DriftMonitor::scan; values above the last bound go to the last bucket.
+            const int *base = first;
+            for (int k = count; k > 1; k -= k >> 1)
+                base = base[(k >> 1) - 1] < value ? base + (k >> 1) : base;
+            nextHits[std::min(count - 1, (int)(base - first) + (*base < value))] += weight;
+        }
+    }
+    cursor = last;
+    if (cursor < store.usedWords())
+        return false;
+    stratum++;
+    cursor = 0;
+    return true;
+}
+
+bool EquiDepthHistogram::finishResize()
+{
+    growing = false;
+    if (splits != resizeSplits || nextUpper.empty())
+        return false;
+    // Inserts may have moved the upper bound of the last bucket since the resize started.
+    nextUpper.back() = upper.back();
+    ArenaVector<double> splitCounts(counts.get_allocator());
+    splitCounts.reserve(nextUpper.size() + 1);
+    int part = 0;
+    for (int i = 0; i < (int)upper.size(); ++i) {
+        int begin = part;
+        double sampled = 0;
+        while (nextUpper[part] != upper[i])
+            sampled += nextHits[part++];
+        sampled += nextHits[part++];
+        // A bucket without sampled values is spread over its parts like its value range.
+        long long lo = lowerOf(i);
+        for (int k = begin; k < part; ++k) {
+            long long from = k == begin ? lo : nextUpper[k - 1];
+            double share = sampled > 0 ? nextHits[k] / sampled : (double)(nextUpper[k] - from) / (upper[i] - lo);
+            splitCounts.push_back(counts[i] * share);
+        }
+    }
+    upper = std::move(nextUpper);
+    counts = std::move(splitCounts);
+    nextHits = ArenaVector<double>(counts.get_allocator());
+    nextUpper = ArenaVector<int>(upper.get_allocator());
+    tree = ArenaVector<double>(counts.get_allocator());
+    tree.reserve(upper.capacity());
+    splits++;
+    unbalanced = false;
+    rebuildTree();
+    return true;
+}
+
+void EquiDepthHistogram::insert(int value)
+{
+    if (upper.empty())
+        return;
+    if (value < lower)
+        lower = value;
+    if (value > upper.back())
+        upper.back() = value;
+    int bucket = bucketOf(value);
+    counts[bucket] += 1;
+    total += 1;
+    add(bucket, 1);
+    if (counts[bucket] > splitThreshold * total / upper.size())
+        unbalanced = true;
+}
+
+bool EquiDepthHistogram::rebalance()
+{
+    if (!unbalanced)
+        return false;
+    double limit = splitThreshold * total / upper.size();
+    // Buckets holding a single value cannot be split; they are skipped and only the heaviest splittable one is cut.
+    int heaviest = -1;
+    for (int i = 0; i < (int)counts.size(); ++i) {
+        long long lo = i == 0 ? (long long)lower - 1 : upper[i - 1];
+        if (counts[i] > limit && upper[i] - lo >= 2 && (heaviest < 0 || counts[i] > counts[heaviest]))
+            heaviest = i;
+    }
+    // The heaviest bucket is split at the middle of its value range.
+    long long lo = heaviest < 0 ? 0 : lowerOf(heaviest);
+    if (heaviest < 0 || !splitBucket(heaviest, (int)(lo + (upper[heaviest] - lo) / 2), 0.5)) {
+        unbalanced = false;
+        return false;
+    }
+    return true;
+}
+
+void EquiDepthHistogram::remove(int value)
+{
+    if (upper.empty())
+        return;
+    int bucket = bucketOf(value);
+    double delta = std::min(1.0, counts[bucket]);
+    counts[bucket] -= delta;
+    total -= delta;
+    add(bucket, -delta);
+}
+
+double EquiDepthHistogram::greater(int value) const
+{
+    if (upper.empty() || value >= upper.back())
+        return 0;
+    if (value < lower)
+        return total;
+    int bucket = (int)(std::upper_bound(upper.begin(), upper.end(), value) - upper.begin());
+    long long lo = bucket == 0 ? (long long)lower - 1 : upper[bucket - 1];
+    long long hi = upper[bucket];
+    double inside = counts[bucket] * (double)(hi - value) / (double)(hi - lo);
+    return std::max(0.0, total - prefix(bucket + 1) + inside);
+}
+
+bool EquiDepthHistogram::estimate(const ColumnRange &range, double, double &rows) const
+{
+    if (upper.empty())
+        return false;
+    double above = range.from <= INT32_MIN ? total : greater((int)(range.from - 1));
+    rows = above - greater((int)range.to);
+    return true;
+}
+
+bool EquiDepthHistogram::estimateSorted(const int *values, int count, double *out) const
+{
+    if (upper.empty())
+        return false;
+    greaterSorted(values, count, out);
+    return true;
+}
+
+void EquiDepthHistogram::greaterSorted(const int *values, int count, double *out) const
+{
+    // The bucket of every value is found by walking the bounds. The rows below it are taken from the tree, as greater
+    // does, so both give the same estimate to the last bit.
+    int bucket = 0;
+    for (int i = 0; i < count; ++i) {
+        int value = values[i];
+        if (upper.empty() || value >= upper.back()) {
+            out[i] = 0;
+            continue;
+        }
+        if (value < lower) {
+            out[i] = total;
+            continue;
+        }
+        while (upper[bucket] <= value)
+            bucket++;
+        long long lo = bucket == 0 ? (long long)lower - 1 : upper[bucket - 1];
+        long long hi = upper[bucket];
+        double inside = counts[bucket] * (double)(hi - value) / (double)(hi - lo);
+        out[i] = std::max(0.0, total - prefix(bucket + 1) + inside);
+    }
+}
+
+void EquiDepthHistogram::save(SnapshotWriter &out) const
+{
+    out.put(lower);
+    out.put(total);
+    out.put(splitThreshold);
+    out.put(unbalanced);
+    out.putVector(upper);
+    out.putVector(counts);
+}
+
+bool EquiDepthHistogram::load(SnapshotReader &in, Arena *arena)
+{
+    upper = ArenaVector<int>(ArenaAllocator<int>(arena));
+    counts = ArenaVector<double>(ArenaAllocator<double>(arena));
+    tree = ArenaVector<double>(ArenaAllocator<double>(arena));
+    in.get(lower);
+    in.get(total);
+    in.get(splitThreshold);
+    in.get(unbalanced);
+    growing = false;
+    in.getVector(upper);
+    in.getVector(counts);
+    if (!in.ok() || upper.size() != counts.size())
+        return false;
+    upper.reserve(upper.size() + 1);
+    counts.reserve(counts.size() + 1);
+    tree.reserve(counts.size() + 1);
+    rebuildTree();
+    return true;
+}
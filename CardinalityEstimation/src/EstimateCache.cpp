@@ -0,0 +1,83 @@
+//
+// Cache of query estimates keyed by the normalized form of their quals.
+//
+
+#include <estimator/EstimateCache.h>
+
+EstimateCache::EstimateCache()
+{
+    this->slotMask = 0;
+    this->tolerance = 0;
+    this->hits = 0;
+    this->misses = 0;
+}
+
+void EstimateCache::init(int entries, double tolerance, Arena *arena)
+{
+    int size = 1;
+    while (size < entries)
+        size <<= 1;
+    this->entries = ArenaVector<Entry>(entries > 0 ? size : 0, Entry(), ArenaAllocator<Entry>(arena));
+    for (int i = 0; i < (int)this->entries.size(); ++i)
+        this->entries[i].columns = -1;
+    this->slotMask = (uint64_t)size - 1;
+    this->tolerance = tolerance;
+}
+
+uint64_t EstimateCache::hashKey(const std::vector<ColumnRange> &key)
+{
+    // FNV-1a over the range bounds, finished with a murmur mix so that the low bits used as slot are well spread.
+    uint64_t h = 1469598103934665603ULL;
+    for (int k = 0; k < (int)key.size(); ++k) {
+        uint64_t parts[3] = {(uint64_t)key[k].column, (uint64_t)key[k].from, (uint64_t)key[k].to};
+        for (int p = 0; p < 3; ++p) {
+            h ^= parts[p];
+            h *= 1099511628211ULL;
+        }
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+bool EstimateCache::lookup(uint64_t hash, const std::vector<ColumnRange> &key, const long long *epochs,
+                           const long long *versions, double rows, double &estimate)
+{
+    if (entries.empty() || (int)key.size() > MAX_COLUMNS)
+        return false;
+    const Entry &entry = entries[hash & slotMask];
+    bool match = entry.hash == hash && entry.columns == (int)key.size();
+    long long modified = 0;
+    for (int k = 0; match && k < entry.columns; ++k) {
+        const ColumnRange &range = entry.ranges[k];
+        match = range.column == key[k].column && range.from == key[k].from && range.to == key[k].to &&
+                entry.versions[k] == versions[range.column];
+        if (match)
+            modified = std::max(modified, epochs[range.column] - entry.epochs[k]);
+    }
+    if (!match || modified > tolerance * rows) {
+        misses++;
+        return false;
+    }
+    hits++;
+    estimate = entry.rows > 0 ? entry.estimate * rows / entry.rows : entry.estimate;
+    return true;
+}
+
+void EstimateCache::store(uint64_t hash, const std::vector<ColumnRange> &key, const long long *epochs,
+                          const long long *versions, double rows, double estimate)
+{
+    if (entries.empty() || (int)key.size() > MAX_COLUMNS)
+        return;
+    Entry &entry = entries[hash & slotMask];
+    entry.hash = hash;
+    entry.columns = (int)key.size();
+    for (int k = 0; k < entry.columns; ++k) {
+        entry.ranges[k] = key[k];
+        entry.epochs[k] = epochs[key[k].column];
+        entry.versions[k] = versions[key[k].column];
+    }
+    entry.rows = rows;
+    entry.estimate = estimate;
+}
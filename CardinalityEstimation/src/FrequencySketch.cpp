@@ -0,0 +1,354 @@
+//
+// Fixed-memory frequency synopses of one column, used for EQUAL selectivity.
+//
+
+#include <estimator/FrequencySketch.h>
+
+CountMinSketch::CountMinSketch()
+{
+    this->depth = 0;
+    this->shift = 64;
+    this->total = 0;
+}
+
+void CountMinSketch::init(int depth, int width, std::mt19937_64 &rng, Arena *arena)
+{
+    int bits = 0;
+    while ((1 << bits) < width)
+        bits++;
+    this->depth = depth;
+    this->shift = 64 - bits;
+    this->total = 0;
+    multipliers = ArenaVector<uint64_t>(depth, 0, ArenaAllocator<uint64_t>(arena));
+    for (int row = 0; row < depth; ++row)
+        multipliers[row] = rng() | 1;
+    counters = ArenaVector<uint32_t>((size_t)depth << bits, 0, ArenaAllocator<uint32_t>(arena));
+}
+
+void CountMinSketch::add(int value, uint32_t weight)
+{
+    int width = 1 << (64 - shift);
+    uint32_t lowest = upperBound(value);
+    for (int row = 0; row < depth; ++row) {
+        uint32_t &counter = counters[(size_t)row * width + cell(row, value)];
+        counter = std::max(counter, lowest + weight);
+    }
+    total += weight;
+}
+
+void CountMinSketch::subtract(int value, uint32_t weight)
+{
+    int width = 1 << (64 - shift);
+    for (int row = 0; row < depth; ++row) {
+        uint32_t &counter = counters[(size_t)row * width + cell(row, value)];
+        counter = counter > weight ? counter - weight : 0;
+    }
+    total = std::max(0LL, total - (long long)weight);
+}
+
+uint32_t CountMinSketch::upperBound(int value) const
+{
+    int width = 1 << (64 - shift);
+    uint32_t lowest = UINT32_MAX;
+    for (int row = 0; row < depth; ++row)
+        lowest = std::min(lowest, counters[(size_t)row * width + cell(row, value)]);
+    return depth == 0 ? 0 : lowest;
+}
+
+double CountMinSketch::estimate(int value) const
+{
+    int width = 1 << (64 - shift);
+    if (depth == 0)
+        return 0;
+    double rows[16];
+    int n = std::min(depth, 16);
+    for (int row = 0; row < n; ++row) {
+        double counter = counters[(size_t)row * width + cell(row, value)];
+        rows[row] = counter - (total - counter) / std::max(1, width - 1);
+    }
+    std::sort(rows, rows + n);
+    double median = n % 2 ? rows[n / 2] : (rows[n / 2 - 1] + rows[n / 2]) / 2;
+    return std::max(0.0, std::min(median, (double)upperBound(value)));
+}
+
+double CountMinSketch::noise() const
+{
+    int width = 1 << (64 - shift);
+    return std::sqrt((double)total / width);
+}
+
+void CountMinSketch::fold(int width, Arena *arena)
+{
+    int bits = 64 - shift;
+    int narrow = 0;
+    while ((1 << narrow) < width)
+        narrow++;
+    if (counters.empty() || narrow >= bits)
+        return;
+    int group = 1 << (bits - narrow);
+    ArenaVector<uint32_t> folded((size_t)depth << narrow, 0, ArenaAllocator<uint32_t>(arena));
+    for (size_t cell = 0; cell < folded.size(); ++cell) {
+        const uint32_t *first = counters.data() + cell * group;
+        uint64_t sum = 0;
+        for (int k = 0; k < group; ++k)
+            sum += first[k];
+        folded[cell] = (uint32_t)std::min<uint64_t>(sum, UINT32_MAX);
+    }
+    counters = std::move(folded);
+    shift = 64 - narrow;
+}
+
+HeavyHitters::HeavyHitters()
+{
+    this->capacity = 0;
+}
+
+void HeavyHitters::init(int capacity, Arena *arena)
+{
+    this->capacity = capacity;
+    values = ArenaVector<int>(ArenaAllocator<int>(arena));
+    counts = ArenaVector<long long>(ArenaAllocator<long long>(arena));
+    errors = ArenaVector<long long>(ArenaAllocator<long long>(arena));
+    values.reserve(capacity);
+    counts.reserve(capacity);
+    errors.reserve(capacity);
+}
+
+int HeavyHitters::slotOf(int value) const
+{
+    // Monitored values are distinct, so the scan needs no early exit and is vectorized.
+    const int *first = values.data();
+    int slot = -1;
+    for (int i = 0; i < (int)values.size(); ++i)
+        slot = first[i] == value ? i : slot;
+    return slot;
+}
+
+void HeavyHitters::add(int value, long long weight)
+{
+    if (capacity == 0)
+        return;
+    int slot = slotOf(value);
+    if (slot >= 0) {
+        counts[slot] += weight;
+        return;
+    }
+    if ((int)values.size() < capacity) {
+        values.push_back(value);
+        counts.push_back(weight);
+        errors.push_back(0);
+        return;
+    }
+    // Replace the least counted value; the newcomer inherits its count as error. The minimum and then its first
+    // slot are found in two branch-free scans.
+    const long long *count = counts.data();
+    int n = (int)counts.size();
+    long long lowest = count[0];
+    for (int i = 1; i < n; ++i)
+        lowest = std::min(lowest, count[i]);
+    int victim = n - 1;
+    for (int i = n - 1; i >= 0; --i)
+        victim = count[i] == lowest ? i : victim;
+    values[victim] = value;
+    errors[victim] = counts[victim];
+    counts[victim] += weight;
+}
+
+void HeavyHitters::subtract(int value, long long weight)
+{
+    int slot = slotOf(value);
+    if (slot >= 0)
+        counts[slot] = std::max(errors[slot], counts[slot] - weight);
+}
+
+bool HeavyHitters::find(int value, long long &lowerBound, long long &upperBound) const
+{
+    int slot = slotOf(value);
+    if (slot < 0)
+        return false;
+    lowerBound = counts[slot] - errors[slot];
+    upperBound = counts[slot];
+    return true;
+}
+
+int HeavyHitters::tighten(const CountMinSketch &sketch, int begin, int count)
+{
+    int end = std::min((int)values.size(), begin + count);
+    for (int i = begin; i < end; ++i) {
+        long long bound = sketch.upperBound(values[i]);
+        if (counts[i] > bound) {
+            long long guaranteed = std::min(counts[i] - errors[i], bound);
+            counts[i] = bound;
+            errors[i] = bound - guaranteed;
+        }
+    }
+    return end >= (int)values.size() ? 0 : end;
+}
+
+void FrequencySketch::init(int depth, int width, int heavyHitters, std::mt19937_64 &rng, Arena *arena)
+{
+    sketch.init(depth, width, rng, arena);
+    heavy.init(heavyHitters, arena);
+}
+
+size_t FrequencySketch::arenaBytes(const EngineConfig &config)
+{
+    // Counters and row seeds of the sketch, and the heavy hitter table.
+    size_t width = 1;
+    while ((int)width < config.sketchWidth)
+        width <<= 1;
+    return (size_t)config.sketchDepth * (width * sizeof(uint32_t) + sizeof(uint64_t)) +
+           (size_t)config.heavyHitters * (sizeof(int) + 2 * sizeof(long long));
+}
+
+void FrequencySketch::build(std::vector<int> &values, double scale, const EngineConfig &config, std::mt19937_64 &rng,
+                            Arena *arena)
+{
+    init(config.sketchDepth, config.sketchWidth, config.heavyHitters, rng, arena);
+    uint32_t weight = (uint32_t)std::max(1LL, std::llround(scale));
+    for (int i = 0; i < (int)values.size(); ++i)
+        insert(values[i], weight);
+}
+
+void FrequencySketch::insert(int value, uint32_t weight)
+{
+    sketch.add(value, weight);
+    heavy.add(value, weight);
+    changed = true;
+}
+
+void FrequencySketch::remove(int value, uint32_t weight)
+{
+    sketch.subtract(value, weight);
+    heavy.subtract(value, weight);
+    changed = true;
+}
+
+double FrequencySketch::equal(int value, double uniform) const
+{
+    double estimate = sketch.estimate(value);
+    long long lowerBound = 0;
+    long long upperBound = 0;
+    if (heavy.find(value, lowerBound, upperBound))
+        return std::max((double)lowerBound, std::min(estimate, (double)upperBound));
+    // An estimate within three standard deviations of the collision noise cannot tell a rare value from an absent one.
+    if (estimate < std::max(1.0, 3 * sketch.noise()))
+        return std::min(uniform, (double)sketch.upperBound(value));
+    return estimate;
+}
+
+void FrequencySketch::shrink(int width, Arena *arena)
+{
+    sketch.fold(width, arena);
+    changed = true;
+}
+
+void FrequencySketch::startGrow(int width, std::mt19937_64 &rng, Arena *arena)
+{
+    next.init(sketch.getDepth(), width, rng, arena);
+    growing = true;
+    stratum = 0;
+    cursor = 0;
+}
+
+bool FrequencySketch::scan(const SampleStore &store, int column, uint32_t weight, int words)
+{
+    int32_t values[64];
+    const uint64_t *live = store.liveWords();
+    int last = std::min(store.usedWords(), cursor + std::max(1, words));
+    for (int w = cursor; w < last && store.initialized(); ++w) {
+        if (live[w] == 0)
+            continue;
+        store.decodeWord(column, w, values);
+        for (uint64_t bits = live[w]; bits != 0; bits &= bits - 1)
+            next.add(values[__builtin_ctzll(bits)], weight);
+    }
+    cursor = last;
+    if (cursor < store.usedWords())
+        return false;
+    stratum++;
+    cursor = 0;
+    return true;
+}
+
+void FrequencySketch::finishGrow()
+{
+    sketch = std::move(next);
+    next = CountMinSketch();
+    growing = false;
+    changed = true;
+}
+
+bool FrequencySketch::compact(int count)
+{
+    if (compactCursor == 0)
+        changed = false;
+    compactCursor = heavy.tighten(sketch, compactCursor, count);
+    return compactCursor == 0;
+}
+
+void CountMinSketch::save(SnapshotWriter &out) const
+{
+    out.put(depth);
+    out.put(shift);
+    out.put(total);
+    out.putVector(multipliers);
+    out.putVector(counters);
+}
+
+bool CountMinSketch::load(SnapshotReader &in, Arena *arena)
+{
+    multipliers = ArenaVector<uint64_t>(ArenaAllocator<uint64_t>(arena));
+    counters = ArenaVector<uint32_t>(ArenaAllocator<uint32_t>(arena));
+    in.get(depth);
+    in.get(shift);
+    in.get(total);
+    in.getVector(multipliers);
+    in.getVector(counters);
+    if (!in.ok())
+        return false;
+    if (counters.empty())
+        return multipliers.empty();
+    return depth > 0 && shift > 0 && shift < 64 && multipliers.size() == (size_t)depth &&
+           counters.size() == ((size_t)depth << (64 - shift));
+}
+
+void HeavyHitters::save(SnapshotWriter &out) const
+{
+    out.put(capacity);
+    out.putVector(values);
+    out.putVector(counts);
+    out.putVector(errors);
+}
+
+bool HeavyHitters::load(SnapshotReader &in, Arena *arena)
+{
+    values = ArenaVector<int>(ArenaAllocator<int>(arena));
+    counts = ArenaVector<long long>(ArenaAllocator<long long>(arena));
+    errors = ArenaVector<long long>(ArenaAllocator<long long>(arena));
+    in.get(capacity);
+    values.reserve(std::max(capacity, 0));
+    counts.reserve(std::max(capacity, 0));
+    errors.reserve(std::max(capacity, 0));
+    in.getVector(values);
+    in.getVector(counts);
+    in.getVector(errors);
+    return in.ok() && values.size() == counts.size() && values.size() == errors.size() &&
+           values.size() <= (size_t)std::max(capacity, 0);
+}
+
+void FrequencySketch::save(SnapshotWriter &out) const
+{
+    out.put(compactCursor);
+    sketch.save(out);
+    heavy.save(out);
+}
+
+bool FrequencySketch::load(SnapshotReader &in, Arena *arena)
+{
+    in.get(compactCursor);
+    growing = false;
+    // Updates before the snapshot are not known to be walked.
+    changed = true;
+    return sketch.load(in, arena) && heavy.load(in, arena);
+}
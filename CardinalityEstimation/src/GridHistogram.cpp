@@ -0,0 +1,140 @@
+//
+// Two-dimensional histogram over a pair of columns, used to correct the independence assumption.
+//
+
+#include <estimator/GridHistogram.h>
+
+GridHistogram::GridHistogram()
+{
+    this->first = 0;
+    this->second = 0;
+    this->cells = 0;
+    lower[0] = lower[1] = 0;
+    upper[0] = upper[1] = 0;
+}
+
+void GridHistogram::build(int first, int second, const std::vector<int> &a, const std::vector<int> &b, double scale,
+                          int cells, Arena *arena)
+{
+    this->first = first;
+    this->second = second;
+    int n = (int)std::min(a.size(), b.size());
+    counts = ArenaVector<double>(ArenaAllocator<double>(arena));
+    if (n == 0 || cells <= 0) {
+        this->cells = 0;
+        return;
+    }
+    this->cells = cells;
+    const std::vector<int> *columns[2] = {&a, &b};
+    std::vector<int> sorted;
+    for (int d = 0; d < 2; ++d) {
+        sorted.assign(columns[d]->begin(), columns[d]->begin() + n);
+        std::sort(sorted.begin(), sorted.end());
+        lower[d] = sorted.front();
+        upper[d] = sorted.back();
+        cuts[d] = ArenaVector<int>(cells - 1, 0, ArenaAllocator<int>(arena));
+        fractions[d] = ArenaVector<double>(cells, 0, ArenaAllocator<double>(arena));
+        for (int k = 1; k < cells; ++k)
+            cuts[d][k - 1] = sorted[std::max(0, (int)((long long)k * n / cells) - 1)];
+    }
+    counts.resize((size_t)cells * cells, 0);
+    for (int i = 0; i < n; ++i)
+        counts[(size_t)cellOf(0, a[i]) * cells + cellOf(1, b[i])] += scale;
+}
+
+int GridHistogram::cellOf(int dimension, int value) const
+{
+    const ArenaVector<int> &bounds = cuts[dimension];
+    return (int)(std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin());
+}
+
+void GridHistogram::insert(int a, int b)
+{
+    if (counts.empty())
+        return;
+    lower[0] = std::min(lower[0], (long long)a);
+    upper[0] = std::max(upper[0], (long long)a);
+    lower[1] = std::min(lower[1], (long long)b);
+    upper[1] = std::max(upper[1], (long long)b);
+    counts[(size_t)cellOf(0, a) * cells + cellOf(1, b)] += 1;
+}
+
+void GridHistogram::remove(int a, int b)
+{
+    if (counts.empty())
+        return;
+    double &count = counts[(size_t)cellOf(0, a) * cells + cellOf(1, b)];
+    count = std::max(0.0, count - 1);
+}
+
+void GridHistogram::coverage(int dimension, const ColumnRange &range, ArenaVector<double> &fractions) const
+{
+    fractions.assign(cells, 0);
+    const ArenaVector<int> &bounds = cuts[dimension];
+    for (int i = 0; i < cells; ++i) {
+        long long lo = i == 0 ? lower[dimension] : (long long)bounds[i - 1] + 1;
+        long long hi = i == cells - 1 ? upper[dimension] : (long long)bounds[i];
+        if (hi < lo)
+            continue;
+        long long overlap = std::min(hi, range.to) - std::max(lo, range.from) + 1;
+        if (overlap > 0)
+            fractions[i] = (double)overlap / (hi - lo + 1);
+    }
+}
+
+double GridHistogram::estimate(const ColumnRange &a, const ColumnRange &b, double &marginalA, double &marginalB) const
+{
+    marginalA = 0;
+    marginalB = 0;
+    if (counts.empty())
+        return 0;
+    ArenaVector<double> &fa = fractions[0];
+    ArenaVector<double> &fb = fractions[1];
+    coverage(0, a, fa);
+    coverage(1, b, fb);
+    double joint = 0;
+    for (int i = 0; i < cells; ++i) {
+        const double *row = &counts[(size_t)i * cells];
+        double rowJoint = 0;
+        for (int j = 0; j < cells; ++j) {
+            rowJoint += row[j] * fb[j];
+            marginalA += row[j] * fa[i];
+        }
+        joint += rowJoint * fa[i];
+        marginalB += rowJoint;
+    }
+    return joint;
+}
+
+void GridHistogram::save(SnapshotWriter &out) const
+{
+    out.put(first);
+    out.put(second);
+    out.put(cells);
+    for (int d = 0; d < 2; ++d) {
+        out.put(lower[d]);
+        out.put(upper[d]);
+        out.putVector(cuts[d]);
+    }
+    out.putVector(counts);
+}
+
+bool GridHistogram::load(SnapshotReader &in, Arena *arena)
+{
+    in.get(first);
+    in.get(second);
+    in.get(cells);
+    for (int d = 0; d < 2; ++d) {
+        in.get(lower[d]);
+        in.get(upper[d]);
+        cuts[d] = ArenaVector<int>(ArenaAllocator<int>(arena));
+        in.getVector(cuts[d]);
+        fractions[d] = ArenaVector<double>(std::max(cells, 0), 0, ArenaAllocator<double>(arena));
+    }
+    counts = ArenaVector<double>(ArenaAllocator<double>(arena));
+    in.getVector(counts);
+    if (!in.ok() || cells < 0)
+        return false;
+    return counts.empty() || (cuts[0].size() == (size_t)cells - 1 && cuts[1].size() == (size_t)cells - 1 &&
+                              counts.size() == (size_t)cells * cells);
+}
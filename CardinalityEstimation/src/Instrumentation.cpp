@@ -0,0 +1,91 @@
+//
+// Hot-path timings of the engine, compiled in only with CE_INSTRUMENT.
+//
+
+#include <estimator/Instrumentation.h>
+#include <cstdio>
+#include <cstring>
+
+static const char *const PROBE_NAMES[PROBE_COUNT] = {"insertTuple", "deleteTuple", "query",      "prepare",
+                                                       "readTuples",  "queryBatch",  "applyStaged"};
+
+static long long steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+Instrumentation::Instrumentation() : ring(RING_SAMPLES)
+{
+    memset(stats, 0, sizeof(stats));
+    this->recorded = 0;
+    this->originTicks = now();
+    this->originNs = steadyNs();
+}
+
+void Instrumentation::record(ProbeOp op, uint64_t begin, uint64_t end, uint32_t detail)
+{
+    uint64_t ticks = end > begin ? end - begin : 0;
+    OpStats &s = stats[op];
+    s.calls++;
+    s.details += detail;
+    s.totalTicks += ticks;
+    s.maxTicks = std::max(s.maxTicks, ticks);
+    int bucket = ticks == 0 ? 0 : 64 - __builtin_clzll(ticks);
+    s.durations[std::min(bucket, DURATION_BUCKETS - 1)]++;
+    ProbeSample &sample = ring[recorded & (RING_SAMPLES - 1)];
+    sample.start = begin - originTicks;
+    sample.ticks = (uint32_t)std::min<uint64_t>(ticks, UINT32_MAX);
+    sample.detail = detail;
+    sample.op = op;
+    recorded++;
+}
+
+std::string Instrumentation::toJson() const
+{
+    // Ticks per nanosecond over the lifetime of the instrumentation.
+    long long elapsedNs = std::max(1LL, steadyNs() - originNs);
+    double tickNs = (double)elapsedNs / std::max<uint64_t>(1, now() - originTicks);
+    std::string out;
+    char line[256];
+    snprintf(line, sizeof(line), "{\"tick_ns\":%.6f,\"elapsed_ns\":%lld,\"ops\":{", tickNs, elapsedNs);
+    out += line;
+    for (int op = 0; op < PROBE_COUNT; ++op) {
+        const OpStats &s = stats[op];
+        snprintf(line, sizeof(line), "%s\"%s\":{\"calls\":%lld,\"detail\":%lld,\"total_ns\":%.0f,\"max_ns\":%.0f,",
+                 op == 0 ? "" : ",", PROBE_NAMES[op], s.calls, s.details, s.totalTicks * tickNs, s.maxTicks * tickNs);
+        out += line;
+        // Bucket k counts the calls of [2^(k-1), 2^k) ticks; trailing empty buckets are dropped.
+        int last = DURATION_BUCKETS;
+        while (last > 0 && s.durations[last - 1] == 0)
+            last--;
+        out += "\"log2_ticks\":[";
+        for (int k = 0; k < last; ++k) {
+            snprintf(line, sizeof(line), "%s%lld", k == 0 ? "" : ",", s.durations[k]);
+            out += line;
+        }
+        out += "]}";
+    }
+    // The ring holds the last RING_SAMPLES calls, oldest first, as [op, start_ns, duration_ns, detail].
+    long long first = std::max(0LL, recorded - RING_SAMPLES);
+    snprintf(line, sizeof(line), "},\"recorded\":%lld,\"samples\":[", recorded);
+    out += line;
+    for (long long k = first; k < recorded; ++k) {
+        const ProbeSample &sample = ring[k & (RING_SAMPLES - 1)];
+        snprintf(line, sizeof(line), "%s[\"%s\",%.0f,%.0f,%u]", k == first ? "" : ",", PROBE_NAMES[sample.op],
+                 sample.start * tickNs, sample.ticks * tickNs, sample.detail);
+        out += line;
+    }
+    out += "]}\n";
+    return out;
+}
+
+bool Instrumentation::dump(const std::string &path) const
+{
+    std::string json = toJson();
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,49 @@
+//
+// Cooperative scheduler of the background maintenance done in CEEngine::prepare().
+//
+
+#include <estimator/MaintenanceScheduler.h>
+
+MaintenanceScheduler::MaintenanceScheduler()
+{
+    this->cursor = 0;
+    this->maxSteps = 1;
+    this->budgetUs = 0;
+}
+
+void MaintenanceScheduler::setBudget(int maxSteps, double budgetUs)
+{
+    this->maxSteps = maxSteps;
+    this->budgetUs = budgetUs;
+}
+
+void MaintenanceScheduler::addTask(const char *name, std::function<bool()> step)
+{
+    tasks.push_back({name, step, 0});
+}
+
+int MaintenanceScheduler::run()
+{
+    int n = (int)tasks.size();
+    if (n == 0 || maxSteps <= 0)
+        return 0;
+    auto begin = std::chrono::steady_clock::now();
+    int done = 0;
+    // Number of consecutive tasks that had nothing to do; a whole idle round ends the run.
+    int idle = 0;
+    while (done < maxSteps && idle < n) {
+        Task &task = tasks[cursor];
+        cursor = (cursor + 1) % n;
+        if (!task.step()) {
+            idle++;
+            continue;
+        }
+        idle = 0;
+        task.slices++;
+        done++;
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - begin;
+        if (elapsed.count() >= budgetUs)
+            break;
+    }
+    return done;
+}
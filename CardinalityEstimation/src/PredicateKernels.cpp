@@ -0,0 +1,305 @@
+//
+// Predicate evaluation over the columnar sample.
+//
+
+#include <estimator/PredicateKernels.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CE_X86_KERNELS 1
+#endif
+
+// A word kernel turns the 64 codes behind one mask word into the 64 bits of that word. The column loops below are
+// instantiated per word kernel and code type so that the kernel is inlined and only the loop is reached through a
+// pointer. Codes of 1 and 2 bytes are unsigned; SIMD has only signed compares, so both sides are biased by the sign bit.
+template <bool Greater, typename Code>
+static inline uint64_t scalarWord(const Code *block, int value)
+{
+    uint64_t bits = 0;
+    for (int b = 0; b < 64; ++b)
+        bits |= (uint64_t)(Greater ? (int)block[b] > value : (int)block[b] == value) << b;
+    return bits;
+}
+
+#ifdef CE_X86_KERNELS
+template <bool Greater>
+__attribute__((target("sse2"))) static inline uint64_t sse2Word(const int32_t *block, int value)
+{
+    __m128i v = _mm_set1_epi32(value);
+    uint64_t bits = 0;
+    for (int k = 0; k < 16; ++k) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(block + 4 * k));
+        __m128i c = Greater ? _mm_cmpgt_epi32(x, v) : _mm_cmpeq_epi32(x, v);
+        bits |= (uint64_t)(unsigned)_mm_movemask_ps(_mm_castsi128_ps(c)) << (4 * k);
+    }
+    return bits;
+}
+
+template <bool Greater>
+__attribute__((target("sse2"))) static inline uint64_t sse2Word(const uint16_t *block, int value)
+{
+    __m128i bias = _mm_set1_epi16((short)0x8000);
+    __m128i v = _mm_xor_si128(_mm_set1_epi16((short)value), bias);
+    uint64_t bits = 0;
+    for (int k = 0; k < 4; ++k) {
+        __m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(block + 16 * k)), bias);
+        __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(block + 16 * k + 8)), bias);
+        __m128i c0 = Greater ? _mm_cmpgt_epi16(x0, v) : _mm_cmpeq_epi16(x0, v);
+        __m128i c1 = Greater ? _mm_cmpgt_epi16(x1, v) : _mm_cmpeq_epi16(x1, v);
+        bits |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_packs_epi16(c0, c1)) << (16 * k);
+    }
+    return bits;
+}
+
+template <bool Greater>
+__attribute__((target("sse2"))) static inline uint64_t sse2Word(const uint8_t *block, int value)
+{
+    __m128i bias = _mm_set1_epi8((char)0x80);
+    __m128i v = _mm_xor_si128(_mm_set1_epi8((char)value), bias);
+    uint64_t bits = 0;
+    for (int k = 0; k < 4; ++k) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(block + 16 * k)), bias);
+        __m128i c = Greater ? _mm_cmpgt_epi8(x, v) : _mm_cmpeq_epi8(x, v);
+        bits |= (uint64_t)(unsigned)_mm_movemask_epi8(c) << (16 * k);
+    }
+    return bits;
+}
+
+template <bool Greater>
+__attribute__((target("avx2"))) static inline uint64_t avx2Word(const int32_t *block, int value)
+{
+    __m256i v = _mm256_set1_epi32(value);
+    uint64_t bits = 0;
+    for (int k = 0; k < 8; ++k) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(block + 8 * k));
+        __m256i c = Greater ? _mm256_cmpgt_epi32(x, v) : _mm256_cmpeq_epi32(x, v);
+        bits |= (uint64_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(c)) << (8 * k);
+    }
+    return bits;
+}
+
+template <bool Greater>
+__attribute__((target("avx2"))) static inline uint64_t avx2Word(const uint16_t *block, int value)
+{
+    __m256i bias = _mm256_set1_epi16((short)0x8000);
+    __m256i v = _mm256_xor_si256(_mm256_set1_epi16((short)value), bias);
+    uint64_t bits = 0;
+    for (int k = 0; k < 2; ++k) {
+        __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(block + 32 * k)), bias);
+        __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(block + 32 * k + 16)), bias);
+        __m256i c0 = Greater ? _mm256_cmpgt_epi16(x0, v) : _mm256_cmpeq_epi16(x0, v);
+        __m256i c1 = Greater ? _mm256_cmpgt_epi16(x1, v) : _mm256_cmpeq_epi16(x1, v);
+        // Packing works within 128-bit lanes, so the 64-bit quarters are put back in order before the movemask.
+        __m256i c = _mm256_permute4x64_epi64(_mm256_packs_epi16(c0, c1), 0xD8);
+        bits |= (uint64_t)(unsigned)_mm256_movemask_epi8(c) << (32 * k);
+    }
+    return bits;
+}
+
+template <bool Greater>
+__attribute__((target("avx2"))) static inline uint64_t avx2Word(const uint8_t *block, int value)
+{
+    __m256i bias = _mm256_set1_epi8((char)0x80);
+    __m256i v = _mm256_xor_si256(_mm256_set1_epi8((char)value), bias);
+    uint64_t bits = 0;
+    for (int k = 0; k < 2; ++k) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(block + 32 * k)), bias);
+        __m256i c = Greater ? _mm256_cmpgt_epi8(x, v) : _mm256_cmpeq_epi8(x, v);
+        bits |= (uint64_t)(unsigned)_mm256_movemask_epi8(c) << (32 * k);
+    }
+    return bits;
+}
+#endif
+
+#define CE_SELECT_LOOPS(Attr, Word)                                                                           \
+    template <bool Greater, typename Code>                                                                     \
+    Attr static void Word##Select(const void *codes, int words, int value, uint64_t *mask, bool combine)       \
+    {                                                                                                          \
+        const Code *values = static_cast<const Code *>(codes);                                                 \
+        for (int w = 0; w < words; ++w) {                                                                      \
+            uint64_t bits = Word<Greater>(values + ((long long)w << 6), value);                                 \
+            mask[w] = combine ? (mask[w] & bits) : bits;                                                       \
+        }                                                                                                      \
+    }                                                                                                          \
+    template <bool Greater, typename Code>                                                                     \
+    Attr static int Word##Count(const void *codes, int words, int value, const uint64_t *mask,                 \
+                                const uint64_t *live, bool combine)                                            \
+    {                                                                                                          \
+        const Code *values = static_cast<const Code *>(codes);                                                 \
+        int count = 0;                                                                                         \
+        for (int w = 0; w < words; ++w) {                                                                      \
+            uint64_t bits = Word<Greater>(values + ((long long)w << 6), value) & live[w];                       \
+            if (combine)                                                                                       \
+                bits &= mask[w];                                                                               \
+            count += __builtin_popcountll(bits);                                                               \
+        }                                                                                                      \
+        return count;                                                                                          \
+    }
+
+CE_SELECT_LOOPS(, scalarWord)
+#ifdef CE_X86_KERNELS
+CE_SELECT_LOOPS(__attribute__((target("sse2,popcnt"))), sse2Word)
+CE_SELECT_LOOPS(__attribute__((target("avx2,popcnt"))), avx2Word)
+#endif
+
+typedef void (*SelectLoop)(const void *codes, int words, int value, uint64_t *mask, bool combine);
+typedef int (*CountLoop)(const void *codes, int words, int value, const uint64_t *mask, const uint64_t *live,
+                         bool combine);
+
+// Code types, indexed by codeIndex of a code width.
+enum { CODE_BYTE = 0, CODE_SHORT = 1, CODE_INT = 2, CODE_TYPES = 3 };
+
+static inline int codeIndex(int width)
+{
+    return width == 1 ? CODE_BYTE : width == 2 ? CODE_SHORT : CODE_INT;
+}
+
+// Loops of the current level, indexed by code type and CompareOp.
+static SelectLoop selectLoops[CODE_TYPES][2];
+static CountLoop countLoops[CODE_TYPES][2];
+static KernelLevel currentLevel = KERNEL_SCALAR;
+
+#define CE_SET_LOOPS(Word)                                                                                     \
+    do {                                                                                                       \
+        selectLoops[CODE_BYTE][EQUAL] = Word##Select<false, uint8_t>;                                         \
+        selectLoops[CODE_BYTE][GREATER] = Word##Select<true, uint8_t>;                                        \
+        selectLoops[CODE_SHORT][EQUAL] = Word##Select<false, uint16_t>;                                       \
+        selectLoops[CODE_SHORT][GREATER] = Word##Select<true, uint16_t>;                                      \
+        selectLoops[CODE_INT][EQUAL] = Word##Select<false, int32_t>;                                          \
+        selectLoops[CODE_INT][GREATER] = Word##Select<true, int32_t>;                                         \
+        countLoops[CODE_BYTE][EQUAL] = Word##Count<false, uint8_t>;                                           \
+        countLoops[CODE_BYTE][GREATER] = Word##Count<true, uint8_t>;                                          \
+        countLoops[CODE_SHORT][EQUAL] = Word##Count<false, uint16_t>;                                         \
+        countLoops[CODE_SHORT][GREATER] = Word##Count<true, uint16_t>;                                        \
+        countLoops[CODE_INT][EQUAL] = Word##Count<false, int32_t>;                                            \
+        countLoops[CODE_INT][GREATER] = Word##Count<true, int32_t>;                                           \
+    } while (0)
+
+static KernelLevel supportedLevel()
+{
+#ifdef CE_X86_KERNELS
+    __builtin_cpu_init();
+    // The count loops of both levels are built with popcnt, which early x86-64 parts with SSE2 lack.
+    if (!__builtin_cpu_supports("popcnt"))
+        return KERNEL_SCALAR;
+    if (__builtin_cpu_supports("avx2"))
+        return KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return KERNEL_SSE2;
+#endif
+    return KERNEL_SCALAR;
+}
+
+KernelLevel setKernelLevel(KernelLevel level)
+{
+    level = std::min(level, supportedLevel());
+    CE_SET_LOOPS(scalarWord);
+#ifdef CE_X86_KERNELS
+    if (level == KERNEL_AVX2)
+        CE_SET_LOOPS(avx2Word);
+    else if (level == KERNEL_SSE2)
+        CE_SET_LOOPS(sse2Word);
+#endif
+    currentLevel = level;
+    return level;
+}
+
+KernelLevel getKernelLevel()
+{
+    return currentLevel;
+}
+
+// Runtime dispatch happens once, before main.
+static KernelLevel initialLevel = setKernelLevel(KERNEL_AVX2);
+
+void selectColumn(const int32_t *values, int words, CompareOp op, int value, uint64_t *mask, bool combine)
+{
+    selectLoops[CODE_INT][op == GREATER](values, words, value, mask, combine);
+}
+
+void selectColumn(const uint16_t *codes, int words, CompareOp op, int code, uint64_t *mask, bool combine)
+{
+    selectLoops[CODE_SHORT][op == GREATER](codes, words, code, mask, combine);
+}
+
+void selectColumn(const uint8_t *codes, int words, CompareOp op, int code, uint64_t *mask, bool combine)
+{
+    selectLoops[CODE_BYTE][op == GREATER](codes, words, code, mask, combine);
+}
+
+int selectColumnCount(const int32_t *values, int words, CompareOp op, int value, const uint64_t *mask,
+                      const uint64_t *live, bool combine)
+{
+    return countLoops[CODE_INT][op == GREATER](values, words, value, mask, live, combine);
+}
+
+int selectColumnCount(const uint16_t *codes, int words, CompareOp op, int code, const uint64_t *mask,
+                      const uint64_t *live, bool combine)
+{
+    return countLoops[CODE_SHORT][op == GREATER](codes, words, code, mask, live, combine);
+}
+
+int selectColumnCount(const uint8_t *codes, int words, CompareOp op, int code, const uint64_t *mask,
+                      const uint64_t *live, bool combine)
+{
+    return countLoops[CODE_BYTE][op == GREATER](codes, words, code, mask, live, combine);
+}
+
+int countMatches(const SampleStore &store, const std::vector<CompareExpression> &quals, std::vector<uint64_t> &mask)
+{
+    // Constants are translated to codes first: one that no code can match answers the query, and one that every
+    // code matches drops out of the conjunction. Translation is cheap, so the second pass repeats it.
+    int last = -1;
+    for (int j = 0; j < (int)quals.size(); ++j) {
+        CodePredicate p = store.translate(quals[j].columnIdx, quals[j].compareOp, quals[j].value);
+        if (p.match == MATCH_NONE)
+            return 0;
+        if (p.match == MATCH_COMPARE)
+            last = j;
+    }
+    if (last < 0)
+        return store.size();
+    int words = store.usedWords();
+    if ((int)mask.size() < words)
+        mask.resize(words);
+    bool combine = false;
+    for (int j = 0; j <= last; ++j) {
+        int column = quals[j].columnIdx;
+        CodePredicate p = store.translate(column, quals[j].compareOp, quals[j].value);
+        if (p.match != MATCH_COMPARE)
+            continue;
+        int type = codeIndex(store.codeWidth(column));
+        if (j == last)
+            return countLoops[type][p.op == GREATER](store.codes(column), words, p.code, mask.data(),
+                                                     store.liveWords(), combine);
+        selectLoops[type][p.op == GREATER](store.codes(column), words, p.code, mask.data(), combine);
+        combine = true;
+    }
+    return 0;
+}
+
+void selectPredicate(const SampleStore &store, const CompareExpression &expr, uint64_t *mask, bool combine)
+{
+    int words = store.usedWords();
+    CodePredicate p = store.translate(expr.columnIdx, expr.compareOp, expr.value);
+    if (p.match == MATCH_ALL) {
+        if (!combine)
+            std::fill(mask, mask + words, ~0ULL);
+    } else if (p.match == MATCH_NONE) {
+        std::fill(mask, mask + words, 0ULL);
+    } else {
+        int type = codeIndex(store.codeWidth(expr.columnIdx));
+        selectLoops[type][p.op == GREATER](store.codes(expr.columnIdx), words, p.code, mask, combine);
+    }
+}
+
+int countMasks(const uint64_t *const *masks, int count, const uint64_t *live, int words)
+{
+    int total = 0;
+    for (int w = 0; w < words; ++w) {
+        uint64_t bits = live[w];
+        for (int k = 0; k < count; ++k)
+            bits &= masks[k][w];
+        total += __builtin_popcountll(bits);
+    }
+    return total;
+}
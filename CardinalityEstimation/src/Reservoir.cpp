@@ -0,0 +1,148 @@
+//
+// Uniform reservoir sample of the tuples seen by the engine.
+//
+
+#include <estimator/Reservoir.h>
+
+Reservoir::Reservoir(int capacity, std::mt19937_64 *rng)
+{
+    this->capacity = capacity;
+    this->seen = 0;
+    this->population = 0;
+    this->sampledDeletes = 0;
+    this->unsampledDeletes = 0;
+    this->rng = rng;
+}
+
+void Reservoir::add(TupleRef tuple, int tupleId)
+{
+    int slot = store.add(tuple, tupleId);
+    if (tupleId >= 0)
+        slotOf.set(tupleId, slot);
+}
+
+void Reservoir::replace(int slot, TupleRef tuple, int tupleId)
+{
+    if (store.tupleId(slot) >= 0)
+        slotOf.erase(store.tupleId(slot));
+    if (tupleId >= 0)
+        slotOf.set(tupleId, slot);
+    store.set(slot, tuple, tupleId);
+}
+
+void Reservoir::evict(int slot)
+{
+    if (store.tupleId(slot) >= 0)
+        slotOf.erase(store.tupleId(slot));
+    store.erase(slot);
+}
+
+void Reservoir::setColumns(int columns, Arena *arena, const std::vector<ColumnPlan> *plans)
+{
+    if (store.initialized() || columns <= 0)
+        return;
+    store.init(columns, capacity, arena, plans);
+    slotOf.init(capacity, arena);
+}
+
+void Reservoir::offer(TupleRef tuple, int tupleId)
+{
+    seen++;
+    if (store.size() < capacity) {
+        add(tuple, tupleId);
+        return;
+    }
+    // A full sample occupies slots 0..capacity-1, so a random index below the capacity is a live slot.
+    long long j = (long long)((*rng)() % (unsigned long long)seen);
+    if (j < capacity)
+        replace((int)j, tuple, tupleId);
+}
+
+void Reservoir::seal()
+{
+    capacity = store.size();
+}
+
+void Reservoir::start(long long population)
+{
+    this->population = population;
+    this->sampledDeletes = 0;
+    this->unsampledDeletes = 0;
+}
+
+void Reservoir::insert(TupleRef tuple, int tupleId)
+{
+    population++;
+    long long pending = sampledDeletes + unsampledDeletes;
+    if (pending == 0) {
+        if (store.size() < capacity) {
+            add(tuple, tupleId);
+            return;
+        }
+        long long j = (long long)((*rng)() % (unsigned long long)population);
+        if (j < capacity)
+            replace((int)j, tuple, tupleId);
+        return;
+    }
+    if ((long long)((*rng)() % (unsigned long long)pending) < sampledDeletes) {
+        add(tuple, tupleId);
+        sampledDeletes--;
+    } else {
+        unsampledDeletes--;
+    }
+}
+
+void Reservoir::remove(int tupleId)
+{
+    population--;
+    // A sampled tuple is found through the slot index; an unsampled one only needs its counters adjusted by the caller.
+    int slot = tupleId >= 0 ? slotOf.find(tupleId) : -1;
+    if (slot < 0) {
+        unsampledDeletes++;
+        return;
+    }
+    evict(slot);
+    sampledDeletes++;
+}
+
+void Reservoir::swapIn(TupleRef tuple, int tupleId)
+{
+    if (store.size() == 0)
+        return;
+    replace(store.randomLiveSlot(*rng), tuple, tupleId);
+}
+
+void Reservoir::shrink()
+{
+    if (capacity > 0)
+        capacity--;
+    if (store.size() > capacity)
+        evict(store.randomLiveSlot(*rng));
+}
+
+void Reservoir::save(SnapshotWriter &out) const
+{
+    out.put(capacity);
+    out.put(seen);
+    out.put(population);
+    out.put(sampledDeletes);
+    out.put(unsampledDeletes);
+    store.save(out);
+}
+
+bool Reservoir::load(SnapshotReader &in, Arena *arena)
+{
+    in.get(capacity);
+    in.get(seen);
+    in.get(population);
+    in.get(sampledDeletes);
+    in.get(unsampledDeletes);
+    if (!store.load(in, arena) || capacity > store.getSlots())
+        return false;
+    slotOf.init(store.getSlots(), arena);
+    for (int slot = 0; slot < store.usedWords() * 64 && slot < store.getSlots(); ++slot) {
+        if (store.isLive(slot) && store.tupleId(slot) >= 0)
+            slotOf.set(store.tupleId(slot), slot);
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+//
+// Builds the initial statistics of the engine from a bounded number of readTuples chunks.
+//
+
+#include <estimator/SampleBootstrap.h>
+
+SampleBootstrap::SampleBootstrap(const EngineConfig &config, TupleBatchReader &reader, std::mt19937_64 *rng)
+    : config(config), reader(reader)
+{
+    this->rng = rng;
+    this->arena = nullptr;
+}
+
+std::vector<long long> SampleBootstrap::chooseBlocks(int num, int chunk, long long budget)
+{
+    // The table is cut into blocks of chunk tuples and the blocks into as many strata as the budget allows. One block
+    // is taken from every stratum, so the chosen blocks cover the whole table whatever its size.
+    long long blocks = (num + (long long)chunk - 1) / chunk;
+    long long picks = std::min(blocks, std::max(1LL, (budget + chunk - 1) / chunk));
+    std::vector<long long> chosen;
+    chosen.reserve(picks);
+    for (long long k = 0; k < picks; ++k) {
+        long long first = k * blocks / picks;
+        long long last = (k + 1) * blocks / picks;
+        long long block = first;
+        if (config.bootstrapMode == BLOCK_RANDOM && last - first > 1)
+            block += (long long)((*rng)() % (unsigned long long)(last - first));
+        chosen.push_back(block);
+    }
+    // Visit the strata in random order, so a bootstrap stopped by the time budget is not biased to the table head.
+    std::shuffle(chosen.begin(), chosen.end(), *rng);
+    return chosen;
+}
+
+void SampleBootstrap::readChunk(int start, int len, Reservoir &reservoir, ArenaVector<ColumnSummary> &summaries,
+                                BootstrapResult &result)
+{
+    readRanges.push_back(std::make_pair(start, len));
+    for (int offset = 0; offset < len;) {
+        int count = std::min(len - offset, reader.batchLimit());
+        int rows = reader.read(start + offset, count);
+        result.chunksRead++;
+        result.tuplesRead += rows;
+        if (rows > 0 && summaries.empty()) {
+            summaries.resize(reader.columnCount());
+            // Without given codings, the first batch previews every column to choose its coding in the sample.
+            if ((int)plans.size() != reader.columnCount()) {
+                plans.assign(reader.columnCount(), ColumnPlan());
+                for (int c = 0; c < (int)plans.size() && config.packSample; ++c)
+                    plans[c] = SampleStore::planColumn(reader.column(c), rows);
+            }
+            reservoir.setColumns(reader.columnCount(), arena, &plans);
+        }
+        for (int c = 0; c < (int)summaries.size(); ++c) {
+            const int32_t *values = reader.column(c);
+            for (int i = 0; i < rows; ++i)
+                summaries[c].add(values[i]);
+        }
+        // Without deleted tuples in the range the i-th returned tuple is at start + i, otherwise its location is
+        // unknown.
+        bool exactIds = rows == count;
+        for (int i = 0; i < rows; ++i)
+            reservoir.offer(reader.tuple(i), exactIds ? start + offset + i : -1);
+        offset += count;
+    }
+}
+
+BootstrapResult SampleBootstrap::run(int num, Reservoir &reservoir, ArenaVector<ColumnSummary> &summaries,
+                                     Arena *arena, const std::vector<ColumnPlan> &plans)
+{
+    this->arena = arena;
+    this->plans = plans;
+    BootstrapResult result;
+    auto begin = std::chrono::steady_clock::now();
+    int chunk = std::max(1, config.bootstrapChunkSize);
+    long long budget = std::max(0, config.bootstrapTupleBudget);
+    auto overTime = [&]() {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+        return elapsed.count() > config.bootstrapTimeBudgetMs;
+    };
+
+    if (num > 0 && budget > 0) {
+        std::vector<long long> blocks = chooseBlocks(num, chunk, std::min<long long>(budget, num));
+        for (int k = 0; k < (int)blocks.size() && !overTime(); ++k) {
+            long long start = blocks[k] * chunk;
+            readChunk((int)start, (int)std::min<long long>(chunk, num - start), reservoir, summaries, result);
+        }
+        result.fullScan = result.tuplesRead >= num;
+    }
+
+    result.columns = (int)summaries.size();
+    const SampleStore &store = reservoir.getStore();
+    std::vector<int> values;
+    for (int c = 0; c < result.columns && store.initialized(); ++c) {
+        store.columnValues(c, values);
+        summaries[c].ndv = estimateDistinct(values, num);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+    result.elapsedMs = elapsed.count();
+    return result;
+}
@@ -0,0 +1,344 @@
+//
+// Columnar storage of the sampled tuples.
+//
+
+#include <estimator/SampleStore.h>
+
+// Largest code of a column of the given width.
+static inline long long maxCode(int width)
+{
+    return width == 1 ? 0xff : width == 2 ? 0xffff : 0xffffffffLL;
+}
+
+SampleStore::SampleStore()
+{
+    this->columns = 0;
+    this->slots = 0;
+    this->liveCount = 0;
+    this->used = 0;
+    this->padded = 0;
+    this->arena = nullptr;
+}
+
+void SampleStore::init(int columns, int slots, Arena *arena, const std::vector<ColumnPlan> *plans)
+{
+    padded = (slots + 63) & ~63;
+    this->columns = columns;
+    this->slots = slots;
+    this->arena = arena;
+    packed = ArenaVector<PackedColumn>(ArenaAllocator<PackedColumn>(arena));
+    packed.resize(columns);
+    for (int c = 0; c < columns; ++c)
+        allocate(packed[c], plans != nullptr && c < (int)plans->size() ? (*plans)[c] : ColumnPlan());
+    live = ArenaVector<uint64_t>(padded >> 6, 0, ArenaAllocator<uint64_t>(arena));
+    ids = ArenaVector<int>(padded, -1, ArenaAllocator<int>(arena));
+    freeSlots = ArenaVector<int>(ArenaAllocator<int>(arena));
+    freeSlots.reserve(padded);
+    liveCount = 0;
+    used = 0;
+}
+
+void SampleStore::allocate(PackedColumn &column, const ColumnPlan &plan)
+{
+    column.encoding = plan.encoding;
+    column.width = plan.encoding == ENCODE_RAW ? 4 : plan.width;
+    column.base = plan.base;
+    column.dictionary = ArenaVector<int32_t>(plan.dictionary.begin(), plan.dictionary.end(),
+                                             ArenaAllocator<int32_t>(arena));
+    if (column.encoding == ENCODE_DICT)
+        column.dictionary.reserve(DICTIONARY_LIMIT);
+    column.codes = ArenaVector<uint64_t>((size_t)padded * column.width / 8, 0, ArenaAllocator<uint64_t>(arena));
+}
+
+ColumnPlan SampleStore::planColumn(const int32_t *values, int count)
+{
+    ColumnPlan plan;
+    if (count <= 0)
+        return plan;
+    int lo = *std::min_element(values, values + count);
+    int hi = *std::max_element(values, values + count);
+    long long range = (long long)hi - lo;
+    // A frame is used while the previewed range fills at most two thirds of it, and is centered on that range so
+    // that values beyond it on either side still fit.
+    for (int width = 1; width <= 2; ++width) {
+        if (range * 3 > maxCode(width) * 2)
+            continue;
+        long long base = lo - (maxCode(width) - range) / 2;
+        base = std::max(base, (long long)INT32_MIN);
+        base = std::min(base, (long long)INT32_MAX - maxCode(width));
+        plan.encoding = ENCODE_FOR;
+        plan.width = width;
+        plan.base = (int)base;
+        return plan;
+    }
+    // A wide range of a few distinct values is coded by rank, keeping room for new values in the dictionary.
+    std::vector<int32_t> distinct(values, values + count);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    if ((int)distinct.size() * 4 <= DICTIONARY_LIMIT) {
+        plan.encoding = ENCODE_DICT;
+        plan.width = 1;
+        plan.dictionary = distinct;
+    }
+    return plan;
+}
+
+std::vector<ColumnPlan> SampleStore::plans() const
+{
+    std::vector<ColumnPlan> out(columns);
+    for (int c = 0; c < columns; ++c) {
+        out[c].encoding = packed[c].encoding;
+        out[c].width = packed[c].width;
+        out[c].base = packed[c].base;
+        out[c].dictionary.assign(packed[c].dictionary.begin(), packed[c].dictionary.end());
+    }
+    return out;
+}
+
+bool SampleStore::encode(const PackedColumn &column, int value, uint32_t &code) const
+{
+    if (column.encoding == ENCODE_RAW) {
+        code = (uint32_t)value;
+        return true;
+    }
+    if (column.encoding == ENCODE_FOR) {
+        long long delta = (long long)value - column.base;
+        code = (uint32_t)delta;
+        return delta >= 0 && delta <= maxCode(column.width);
+    }
+    auto it = std::lower_bound(column.dictionary.begin(), column.dictionary.end(), value);
+    code = (uint32_t)(it - column.dictionary.begin());
+    return it != column.dictionary.end() && *it == value;
+}
+
+void SampleStore::store(PackedColumn &column, int slot, uint32_t code)
+{
+    void *codes = column.codes.data();
+    if (column.width == 1)
+        static_cast<uint8_t *>(codes)[slot] = (uint8_t)code;
+    else if (column.width == 2)
+        static_cast<uint16_t *>(codes)[slot] = (uint16_t)code;
+    else
+        static_cast<int32_t *>(codes)[slot] = (int32_t)code;
+}
+
+int SampleStore::value(int column, int slot) const
+{
+    const PackedColumn &p = packed[column];
+    const void *codes = p.codes.data();
+    if (p.encoding == ENCODE_RAW)
+        return static_cast<const int32_t *>(codes)[slot];
+    int code = p.width == 1 ? static_cast<const uint8_t *>(codes)[slot] : static_cast<const uint16_t *>(codes)[slot];
+    return p.encoding == ENCODE_DICT ? p.dictionary[code] : p.base + code;
+}
+
+void SampleStore::decodeWord(int column, int word, int32_t *out) const
+{
+    const PackedColumn &p = packed[column];
+    int first = word << 6;
+    if (p.encoding == ENCODE_RAW) {
+        memcpy(out, static_cast<const int32_t *>(codes(column)) + first, 64 * sizeof(int32_t));
+    } else if (p.width == 2) {
+        const uint16_t *in = static_cast<const uint16_t *>(codes(column)) + first;
+        for (int i = 0; i < 64; ++i)
+            out[i] = p.base + in[i];
+    } else if (p.encoding == ENCODE_FOR) {
+        const uint8_t *in = static_cast<const uint8_t *>(codes(column)) + first;
+        for (int i = 0; i < 64; ++i)
+            out[i] = p.base + in[i];
+    } else {
+        const uint8_t *in = static_cast<const uint8_t *>(codes(column)) + first;
+        for (int i = 0; i < 64; ++i)
+            out[i] = p.dictionary[std::min<int>(in[i], (int)p.dictionary.size() - 1)];
+    }
+}
+
+void SampleStore::widen(int column, int value)
+{
+    PackedColumn &p = packed[column];
+    if (p.encoding == ENCODE_DICT && (int)p.dictionary.size() < DICTIONARY_LIMIT) {
+        // A dictionary with room takes the value, and the codes of the larger values move up by one rank.
+        auto at = std::lower_bound(p.dictionary.begin(), p.dictionary.end(), value);
+        int rank = (int)(at - p.dictionary.begin());
+        p.dictionary.insert(at, value);
+        uint8_t *codes = reinterpret_cast<uint8_t *>(p.codes.data());
+        for (int slot = 0; slot < used; ++slot)
+            codes[slot] += codes[slot] >= rank;
+        return;
+    }
+    // Otherwise the live values and the new one choose a new coding, and the column is recoded.
+    std::vector<int32_t> values;
+    values.reserve(liveCount + 1);
+    std::vector<int32_t> previous(used, value);
+    for (int slot = 0; slot < used; ++slot) {
+        if (isLive(slot)) {
+            previous[slot] = this->value(column, slot);
+            values.push_back(previous[slot]);
+        }
+    }
+    values.push_back(value);
+    ColumnPlan plan = planColumn(values.data(), (int)values.size());
+    if (plan.encoding == ENCODE_DICT && p.encoding == ENCODE_DICT)
+        plan = ColumnPlan();
+    allocate(p, plan);
+    for (int slot = 0; slot < used; ++slot) {
+        uint32_t code = 0;
+        encode(p, previous[slot], code);
+        store(p, slot, isLive(slot) ? code : 0);
+    }
+}
+
+CodePredicate SampleStore::translate(int column, CompareOp op, int value) const
+{
+    const PackedColumn &p = packed[column];
+    CodePredicate out = {MATCH_COMPARE, op, value};
+    if (p.encoding == ENCODE_RAW)
+        return out;
+    long long code;
+    long long last;
+    if (p.encoding == ENCODE_FOR) {
+        code = (long long)value - p.base;
+        last = maxCode(p.width);
+        if (op == EQUAL && (code < 0 || code > last))
+            out.match = MATCH_NONE;
+    } else {
+        auto it = std::upper_bound(p.dictionary.begin(), p.dictionary.end(), value);
+        // Rank of the largest dictionary value not above the constant, -1 if there is none.
+        code = (long long)(it - p.dictionary.begin()) - 1;
+        last = (long long)p.dictionary.size() - 1;
+        if (op == EQUAL && (code < 0 || p.dictionary[code] != value))
+            out.match = MATCH_NONE;
+    }
+    if (op == GREATER && code < 0)
+        out.match = MATCH_ALL;
+    else if (op == GREATER && code >= last)
+        out.match = MATCH_NONE;
+    out.code = (int)std::max(0LL, std::min(code, last));
+    return out;
+}
+
+int SampleStore::add(TupleRef tuple, int tupleId)
+{
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = used++;
+    }
+    live[slot >> 6] |= 1ULL << (slot & 63);
+    liveCount++;
+    set(slot, tuple, tupleId);
+    return slot;
+}
+
+void SampleStore::set(int slot, TupleRef tuple, int tupleId)
+{
+    for (int c = 0; c < columns; ++c) {
+        uint32_t code;
+        if (!encode(packed[c], tuple[c], code)) {
+            widen(c, tuple[c]);
+            encode(packed[c], tuple[c], code);
+        }
+        store(packed[c], slot, code);
+    }
+    ids[slot] = tupleId;
+}
+
+void SampleStore::erase(int slot)
+{
+    live[slot >> 6] &= ~(1ULL << (slot & 63));
+    liveCount--;
+    ids[slot] = -1;
+    freeSlots.push_back(slot);
+}
+
+void SampleStore::columnValues(int column, std::vector<int> &out) const
+{
+    out.clear();
+    int32_t block[64];
+    for (int w = 0; w < usedWords(); ++w) {
+        if (live[w] == 0)
+            continue;
+        decodeWord(column, w, block);
+        for (uint64_t bits = live[w]; bits != 0; bits &= bits - 1)
+            out.push_back(block[__builtin_ctzll(bits)]);
+    }
+}
+
+int SampleStore::randomLiveSlot(std::mt19937_64 &rng) const
+{
+    // Freed slots are reused first, so live slots are dense among the used ones and rejection ends quickly.
+    int slot;
+    do {
+        slot = (int)(rng() % (unsigned long long)used);
+    } while (!isLive(slot));
+    return slot;
+}
+
+size_t SampleStore::codeBytes() const
+{
+    size_t bytes = 0;
+    for (int c = 0; c < columns; ++c)
+        bytes += packed[c].codes.size() * sizeof(uint64_t) + packed[c].dictionary.size() * sizeof(int32_t);
+    return bytes;
+}
+
+void SampleStore::save(SnapshotWriter &out) const
+{
+    out.put(columns);
+    out.put(slots);
+    out.put(liveCount);
+    out.put(used);
+    out.put(padded);
+    for (int c = 0; c < columns; ++c) {
+        out.put((int)packed[c].encoding);
+        out.put(packed[c].width);
+        out.put(packed[c].base);
+        out.putVector(packed[c].dictionary);
+        out.putVector(packed[c].codes);
+    }
+    out.putVector(live);
+    out.putVector(ids);
+    out.putVector(freeSlots);
+}
+
+bool SampleStore::load(SnapshotReader &in, Arena *arena)
+{
+    this->arena = arena;
+    packed = ArenaVector<PackedColumn>(ArenaAllocator<PackedColumn>(arena));
+    live = ArenaVector<uint64_t>(ArenaAllocator<uint64_t>(arena));
+    ids = ArenaVector<int>(ArenaAllocator<int>(arena));
+    freeSlots = ArenaVector<int>(ArenaAllocator<int>(arena));
+    in.get(columns);
+    in.get(slots);
+    in.get(liveCount);
+    in.get(used);
+    in.get(padded);
+    if (!in.ok() || columns < 0 || columns > (1 << 16) || padded < slots || (padded & 63) != 0)
+        return false;
+    packed.resize(columns);
+    for (int c = 0; c < columns; ++c) {
+        PackedColumn &p = packed[c];
+        int encoding = 0;
+        p.dictionary = ArenaVector<int32_t>(ArenaAllocator<int32_t>(arena));
+        p.codes = ArenaVector<uint64_t>(ArenaAllocator<uint64_t>(arena));
+        in.get(encoding);
+        in.get(p.width);
+        in.get(p.base);
+        in.getVector(p.dictionary);
+        in.getVector(p.codes);
+        p.encoding = (ColumnEncoding)encoding;
+        bool widthOk = encoding == ENCODE_RAW ? p.width == 4 : encoding == ENCODE_FOR ? p.width == 1 || p.width == 2
+                                                                                           : p.width == 1;
+        if (!in.ok() || encoding < ENCODE_RAW || encoding > ENCODE_DICT || !widthOk ||
+            p.codes.size() != (size_t)padded * p.width / 8 || p.dictionary.size() > (size_t)DICTIONARY_LIMIT ||
+            (encoding == ENCODE_DICT && p.dictionary.empty()))
+            return false;
+    }
+    freeSlots.reserve(padded);
+    in.getVector(live);
+    in.getVector(ids);
+    in.getVector(freeSlots);
+    return in.ok() && used <= slots && live.size() == (size_t)(padded >> 6) && ids.size() == (size_t)padded;
+}
@@ -0,0 +1,68 @@
+//
+// Map from the tupleId of a sampled tuple to its sample slot.
+//
+
+#include <estimator/SlotIndex.h>
+
+static uint32_t tableSize(int keys)
+{
+    uint32_t size = 16;
+    while (size < (uint32_t)keys * 2)
+        size <<= 1;
+    return size;
+}
+
+SlotIndex::SlotIndex()
+{
+    this->mask = 0;
+    this->shift = 32;
+    this->count = 0;
+}
+
+void SlotIndex::init(int keys, Arena *arena)
+{
+    uint32_t size = tableSize(keys);
+    Entry empty = {EMPTY, -1};
+    entries = ArenaVector<Entry>(size, empty, ArenaAllocator<Entry>(arena));
+    mask = size - 1;
+    shift = 32 - __builtin_ctz(size);
+    count = 0;
+}
+
+void SlotIndex::set(int key, int slot)
+{
+    uint32_t i = home(key);
+    while (entries[i].key != EMPTY && entries[i].key != key)
+        i = (i + 1) & mask;
+    if (entries[i].key == EMPTY)
+        count++;
+    entries[i].key = key;
+    entries[i].slot = slot;
+}
+
+void SlotIndex::erase(int key)
+{
+    if (count == 0)
+        return;
+    uint32_t i = home(key);
+    while (entries[i].key != key) {
+        if (entries[i].key == EMPTY)
+            return;
+        i = (i + 1) & mask;
+    }
+    count--;
+    // Backward-shift deletion: move up every later entry of the run whose home is not between the hole and itself.
+    for (uint32_t j = (i + 1) & mask; entries[j].key != EMPTY; j = (j + 1) & mask) {
+        uint32_t h = home(entries[j].key);
+        if (((j - h) & mask) >= ((j - i) & mask)) {
+            entries[i] = entries[j];
+            i = j;
+        }
+    }
+    entries[i].key = EMPTY;
+}
+
+size_t SlotIndex::tableBytes(int keys)
+{
+    return (size_t)tableSize(keys) * sizeof(Entry);
+}
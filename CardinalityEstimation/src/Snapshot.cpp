@@ -0,0 +1,98 @@
+//
+// Binary snapshot of the engine statistics.
+//
+
+#include <estimator/Snapshot.h>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char SNAPSHOT_MAGIC[8] = {'C', 'E', 'S', 'N', 'A', 'P', 'S', 'H'};
+static const uint32_t SNAPSHOT_FORMAT = 1;
+
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t payloadBytes;
+    uint64_t checksum;
+} SnapshotHeader;
+
+static uint64_t checksumOf(const char *data, size_t bytes)
+{
+    // Word-at-a-time multiply-xor hash; the payload is padded to whole words.
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ bytes;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+bool SnapshotWriter::writeFile(const std::string &path) const
+{
+    std::vector<char> payload(buffer);
+    payload.resize((payload.size() + 7) & ~(size_t)7, 0);
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.format = SNAPSHOT_FORMAT;
+    header.reserved = 0;
+    header.payloadBytes = payload.size();
+    header.checksum = checksumOf(payload.data(), payload.size());
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+SnapshotReader::SnapshotReader()
+{
+    this->base = nullptr;
+    this->length = 0;
+    this->cursor = nullptr;
+    this->end = nullptr;
+    this->valid = false;
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    if (base != nullptr)
+        munmap((void *)base, length);
+}
+
+bool SnapshotReader::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(SnapshotHeader))
+        mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    base = static_cast<const char *>(mapping);
+    length = (size_t)info.st_size;
+    SnapshotHeader header;
+    memcpy(&header, base, sizeof(header));
+    const char *payload = base + sizeof(header);
+    valid = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 && header.format == SNAPSHOT_FORMAT &&
+            header.payloadBytes == length - sizeof(header) &&
+            header.checksum == checksumOf(payload, (size_t)header.payloadBytes);
+    cursor = payload;
+    end = payload + (valid ? header.payloadBytes : 0);
+    return valid;
+}
@@ -0,0 +1,54 @@
+//
+// Batched reader on top of DataExecuter::readTuples.
+//
+
+#include <estimator/TupleBatchReader.h>
+
+TupleBatchReader::TupleBatchReader(DataExecuter *dataExecuter, int cacheBytes)
+{
+    this->dataExecuter = dataExecuter;
+    this->cacheBytes = cacheBytes;
+    this->limit = 64;
+    this->columns = 0;
+    this->rows = 0;
+    this->tuplesRead = 0;
+    this->calls = 0;
+    this->instrumentation = nullptr;
+}
+
+size_t TupleBatchReader::bufferBytes() const
+{
+    // The per-tuple vectors of the last batch are counted like the batch was sized, see read.
+    size_t perTuple = sizeof(std::vector<int>) + 16 + sizeof(int) * (size_t)columns;
+    return batch.capacity() * sizeof(std::vector<int>) + batch.size() * (perTuple - sizeof(std::vector<int>)) +
+           arena.capacity() * sizeof(int32_t);
+}
+
+int TupleBatchReader::read(int start, int count)
+{
+    batch.clear();
+    {
+        CE_PROBE(instrumentation, PROBE_READ, 0);
+        dataExecuter->readTuples(start, count, batch);
+        CE_PROBE_DETAIL((uint32_t)batch.size());
+    }
+    calls++;
+    rows = (int)batch.size();
+    tuplesRead += rows;
+    if (rows > 0 && columns == 0) {
+        // Size the batch once the tuple width is known: an inner vector costs its header, its values and the
+        // allocator overhead, and the arena costs the values again.
+        columns = (int)batch[0].size();
+        long long perTuple = sizeof(std::vector<int>) + 16 + 8LL * columns;
+        limit = (int)std::max(64LL, cacheBytes / perTuple);
+        batch.reserve(limit);
+        arena.assign((size_t)limit * columns, 0);
+    }
+    rows = std::min(rows, limit);
+    for (int c = 0; c < columns; ++c) {
+        int32_t *out = arena.data() + (long long)c * limit;
+        for (int i = 0; i < rows; ++i)
+            out[i] = batch[i][c];
+    }
+    return rows;
+}
@@ -0,0 +1,194 @@
+//
+// Column value distributions of the demo generator.
+//
+
+#include <executer/ValueGenerator.h>
+#include <cstring>
+
+double DemoRandom::gaussian()
+{
+    double u = uniform01();
+    double v = uniform01();
+    return std::sqrt(-2 * std::log(u)) * std::cos(2 * M_PI * v);
+}
+
+static int clip(double value, int maxValue)
+{
+    return (int)std::max(0.0, std::min((double)maxValue, std::floor(value)));
+}
+
+class UniformGenerator : public ValueGenerator {
+private:
+    int maxValue;
+    DemoRandom *random;
+
+public:
+    UniformGenerator(int maxValue, DemoRandom *random)
+    {
+        this->maxValue = maxValue;
+        this->random = random;
+    }
+    // A single draw per value, as the original demo draws it.
+    int next(long long index, const int *tuple)
+    {
+        return maxValue < RAND_MAX ? random->next() % (maxValue + 1) : random->next();
+    }
+};
+
+class ZipfGenerator : public ValueGenerator {
+private:
+    int maxValue;
+    DemoRandom *random;
+    std::vector<double> cdf;
+
+public:
+    ZipfGenerator(const ColumnSpec &spec, int maxValue, DemoRandom *random)
+    {
+        this->maxValue = maxValue;
+        this->random = random;
+        int ranks = (int)std::max(1LL, std::min((long long)spec.distinct, (long long)maxValue + 1));
+        cdf.resize(ranks);
+        double sum = 0;
+        for (int k = 0; k < ranks; ++k) {
+            sum += std::pow(k + 1.0, -spec.skew);
+            cdf[k] = sum;
+        }
+        for (int k = 0; k < ranks; ++k)
+            cdf[k] /= sum;
+    }
+    int next(long long index, const int *tuple)
+    {
+        int rank = (int)(std::lower_bound(cdf.begin(), cdf.end(), random->uniform01()) - cdf.begin());
+        rank = std::min(rank, (int)cdf.size() - 1);
+        // Scatter the ranks over the domain so the frequent values are not all next to each other.
+        return (int)((unsigned long long)rank * 2654435761ULL % ((unsigned long long)maxValue + 1));
+    }
+};
+
+class NormalGenerator : public ValueGenerator {
+private:
+    int maxValue;
+    double sigma;
+    DemoRandom *random;
+
+public:
+    NormalGenerator(const ColumnSpec &spec, int maxValue, DemoRandom *random)
+    {
+        this->maxValue = maxValue;
+        this->random = random;
+        this->sigma = spec.spread * ((double)maxValue + 1);
+    }
+    int next(long long index, const int *tuple) { return clip(maxValue / 2.0 + sigma * random->gaussian(), maxValue); }
+};
+
+class ClusteredGenerator : public ValueGenerator {
+private:
+    int maxValue;
+    double sigma;
+    DemoRandom *random;
+    std::vector<double> centers;
+
+public:
+    ClusteredGenerator(const ColumnSpec &spec, int maxValue, DemoRandom *random)
+    {
+        this->maxValue = maxValue;
+        this->random = random;
+        this->sigma = spec.spread / std::max(1, spec.clusters) * ((double)maxValue + 1);
+        for (int k = 0; k < std::max(1, spec.clusters); ++k)
+            centers.push_back(random->uniform01() * maxValue);
+    }
+    int next(long long index, const int *tuple)
+    {
+        double center = centers[random->next() % centers.size()];
+        return clip(center + sigma * random->gaussian(), maxValue);
+    }
+};
+
+class SortedGenerator : public ValueGenerator {
+private:
+    int maxValue;
+    double step;
+    double jitter;
+    DemoRandom *random;
+
+public:
+    SortedGenerator(const ColumnSpec &spec, int maxValue, long long rows, DemoRandom *random)
+    {
+        this->maxValue = maxValue;
+        this->random = random;
+        this->step = ((double)maxValue + 1) / std::max(1LL, rows);
+        this->jitter = spec.spread * ((double)maxValue + 1);
+    }
+    int next(long long index, const int *tuple)
+    {
+        // A query constant has no position; it is drawn over the whole domain.
+        if (tuple == nullptr)
+            return clip(random->uniform01() * maxValue, maxValue);
+        return clip(index * step + jitter * random->uniform01(), maxValue);
+    }
+};
+
+class CorrelatedGenerator : public ValueGenerator {
+private:
+    std::unique_ptr<ValueGenerator> base;
+    int maxValue;
+    int source;
+    double correlation;
+    double jitter;
+    DemoRandom *random;
+
+public:
+    CorrelatedGenerator(std::unique_ptr<ValueGenerator> base, const ColumnSpec &spec, int maxValue, DemoRandom *random)
+        : base(std::move(base))
+    {
+        this->maxValue = maxValue;
+        this->random = random;
+        this->source = spec.source;
+        this->correlation = spec.correlation;
+        this->jitter = spec.spread / 10 * ((double)maxValue + 1);
+    }
+    int next(long long index, const int *tuple)
+    {
+        if (tuple == nullptr || random->uniform01() >= correlation)
+            return base->next(index, tuple);
+        return clip(tuple[source] + jitter * (random->uniform01() - 0.5), maxValue);
+    }
+};
+
+std::unique_ptr<ValueGenerator> makeGenerator(const ColumnSpec &spec, int maxValue, long long rows,
+                                              DemoRandom *random)
+{
+    std::unique_ptr<ValueGenerator> generator;
+    switch (spec.distribution) {
+        case DIST_ZIPF:
+            generator.reset(new ZipfGenerator(spec, maxValue, random));
+            break;
+        case DIST_NORMAL:
+            generator.reset(new NormalGenerator(spec, maxValue, random));
+            break;
+        case DIST_CLUSTERED:
+            generator.reset(new ClusteredGenerator(spec, maxValue, random));
+            break;
+        case DIST_SORTED:
+            generator.reset(new SortedGenerator(spec, maxValue, rows, random));
+            break;
+        default:
+            generator.reset(new UniformGenerator(maxValue, random));
+            break;
+    }
+    if (spec.source >= 0)
+        generator.reset(new CorrelatedGenerator(std::move(generator), spec, maxValue, random));
+    return generator;
+}
+
+bool parseDistribution(const char *name, Distribution &distribution)
+{
+    static const char *names[] = {"uniform", "zipf", "normal", "clustered", "sorted"};
+    for (int d = 0; d < 5; ++d) {
+        if (strcmp(name, names[d]) == 0) {
+            distribution = (Distribution)d;
+            return true;
+        }
+    }
+    return false;
+}